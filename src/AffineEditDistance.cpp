@@ -0,0 +1,428 @@
+#include "AffineEditDistance.hpp"
+
+#include <algorithm>
+#include <thread>
+
+#include "BasicEditDistance.hpp"
+#include "Metrics.hpp"
+#include "StripedScratch.hpp"
+
+// scores of the 16-bit kernels saturate at 0xFFFF; the 32-bit ones and the
+// scalar loop treat AFFINE_BLOCKED as unreachable
+#define AFFINE_NARROW_LIMIT 0xFFFFLL
+#define AFFINE_WIDE_LIMIT (AFFINE_BLOCKED / 2)
+
+// addition saturating at AFFINE_BLOCKED, for costs up to AFFINE_BLOCKED
+static inline int addCost(int a, int b) {
+  return min(a + b, AFFINE_BLOCKED);
+}
+
+/*
+  The reference recurrence, column by column so the last column is at hand
+  for lastH and lastE: h and e hold the costs of the current column, f
+  runs down it.
+*/
+int affineEditDistanceScalar(const AffineEditDistanceProblem& problem) {
+  int n = problem.rows;
+  int m = problem.columns;
+  int extend = problem.gapExtend;
+  int first = addCost(problem.gapOpen, extend);
+
+  vector<int> h(n + 1), e(n + 1, AFFINE_BLOCKED);
+  h[0] = problem.corner;
+  e[0] = problem.insertStart;
+  // the first column is a single delete gap
+  for (int i = 1; i <= n; i++) {
+    h[i] = addCost(h[i - 1], i == 1 ? first : extend);
+  }
+
+  for (int j = 1; j <= m; j++) {
+    const int32_t* costs = problem.cost + problem.second[j - 1];
+    int diagonal = h[0];
+    e[0] = min(addCost(e[0], extend), addCost(h[0], first));
+    h[0] = e[0];
+    int f = AFFINE_BLOCKED;
+    for (int i = 1; i <= n; i++) {
+      e[i] = min(addCost(e[i], extend), addCost(h[i], first));
+      f = min(addCost(f, extend), addCost(h[i - 1], first));
+      int current = addCost(diagonal, costs[problem.first[i - 1] * problem.symbols]);
+      current = min(current, min(e[i], f));
+      diagonal = h[i];
+      h[i] = current;
+    }
+  }
+
+  if (problem.lastH != NULL) {
+    copy(h.begin(), h.end(), problem.lastH);
+    copy(e.begin(), e.end(), problem.lastE);
+  }
+  return h[n];
+}
+
+AffineEditDistance::AffineEditDistance(const string& first,
+                                       const string& second, int gapOpen,
+                                       int gapExtend, int mismatch)
+    : gapOpen_(gapOpen),
+      gapExtend_(gapExtend),
+      mismatch_(mismatch),
+      threads_(1),
+      symbols_(0) {
+  setStrings(first, second);
+}
+
+void AffineEditDistance::setStrings(const string& first,
+                                    const string& second) {
+  first_ = first;
+  second_ = second;
+}
+
+void AffineEditDistance::setGapCosts(int gapOpen, int gapExtend) {
+  gapOpen_ = gapOpen;
+  gapExtend_ = gapExtend;
+}
+
+void AffineEditDistance::setMismatch(int mismatch) {
+  mismatch_ = mismatch;
+  costs_.clear();
+}
+
+void AffineEditDistance::setCosts(int c1, int c2, int value) {
+  if (costs_.empty()) {
+    costs_.resize(256 * 256);
+    for (int i = 0; i < 256; i++) {
+      for (int j = 0; j < 256; j++) {
+        costs_[i * 256 + j] = i != j ? mismatch_ : 0;
+      }
+    }
+  }
+  costs_[(unsigned char)c1 * 256 + (unsigned char)c2] = value;
+}
+
+int AffineEditDistance::getCost(int c1, int c2) const {
+  unsigned char a = c1;
+  unsigned char b = c2;
+  if (costs_.empty()) return a != b ? mismatch_ : 0;
+  return costs_[a * 256 + b];
+}
+
+void AffineEditDistance::setThreads(int threads) { threads_ = threads; }
+
+/*
+  Gives every byte used by either string a dense code and gathers the
+  replacement costs of those codes into table_, like
+  BasicEditDistance::encode() but without a blank.
+*/
+void AffineEditDistance::encode() {
+  int codes[256];
+  for (int c = 0; c < 256; c++) codes[c] = -1;
+  uint8_t bytes[256];
+  symbols_ = 0;
+
+  firstCodes_.resize(first_.size());
+  for (unsigned int i = 0; i < first_.size(); i++) {
+    unsigned char c = first_[i];
+    if (codes[c] < 0) {
+      bytes[symbols_] = c;
+      codes[c] = symbols_++;
+    }
+    firstCodes_[i] = codes[c];
+  }
+  secondCodes_.resize(second_.size());
+  for (unsigned int j = 0; j < second_.size(); j++) {
+    unsigned char c = second_[j];
+    if (codes[c] < 0) {
+      bytes[symbols_] = c;
+      codes[c] = symbols_++;
+    }
+    secondCodes_[j] = codes[c];
+  }
+
+  table_.resize(symbols_ * symbols_);
+  for (int a = 0; a < symbols_; a++) {
+    for (int b = 0; b < symbols_; b++) {
+      table_[a * symbols_ + b] = getCost(bytes[a], bytes[b]);
+    }
+  }
+}
+
+/*
+  Runs the widest kernel the CPU supports whose scores cannot overflow: a
+  path never costs more than opening and extending gaps over both strings,
+  and the kernels add one more gap or replacement before taking minima.
+*/
+static int runAffineKernel(const AffineEditDistanceProblem& problem,
+                           vector<uint8_t>& scratch) {
+  long long largest = problem.gapOpen + problem.gapExtend;
+  for (int i = 0; i < problem.symbols * problem.symbols; i++) {
+    largest = max(largest, (long long)problem.cost[i]);
+  }
+  long long bound = 3LL * problem.gapOpen +
+                    (long long)(problem.rows + problem.columns) *
+                        problem.gapExtend +
+                    largest;
+
+  BasicEditDistanceKernels::Kernel kernel = BasicEditDistanceKernels::getKernel();
+  if (kernel == BasicEditDistanceKernels::KERNEL_SCALAR ||
+      bound >= AFFINE_WIDE_LIMIT) {
+    return affineEditDistanceScalar(problem);
+  }
+  bool wide = bound >= AFFINE_NARROW_LIMIT;
+  size_t size = stripedScratchSize(problem.rows, problem.second,
+                                   problem.columns, 3);
+  if (scratch.size() < size) scratch.resize(size);
+  if (kernel == BasicEditDistanceKernels::KERNEL_AVX2) {
+    return affineEditDistanceAvx2(problem, wide, scratch.data());
+  }
+  return affineEditDistanceSse42(problem, wide, scratch.data());
+}
+
+int AffineEditDistance::calculate() {
+  PhaseTimer timer(Metrics::FILL);
+  encode();
+  AffineEditDistanceProblem problem = {
+      firstCodes_.data(), (int)firstCodes_.size(), secondCodes_.data(),
+      (int)secondCodes_.size(), table_.data(), symbols_, gapOpen_,
+      gapExtend_, 0, AFFINE_BLOCKED, NULL, NULL};
+  return runAffineKernel(problem, scratch_.kernel);
+}
+
+/*
+  Computes the distance and an optimal alignment in O(n + m) memory, by
+  Myers and Miller's divide and conquer over the affine recurrence (see
+  alignRange).
+*/
+pair<int, pair<string, string> > AffineEditDistance::calculate_with_path() {
+  encode();
+  int n = firstCodes_.size();
+  int m = secondCodes_.size();
+  int threads = threads_ > 0 ? threads_ : (int)thread::hardware_concurrency();
+
+  vector<int> path;
+  path.reserve(n + m);
+  {
+    PhaseTimer timer(Metrics::FILL);
+    alignRange(firstCodes_.data(), n, secondCodes_.data(), m, false, false,
+               max(1, threads), path, scratch_);
+  }
+
+  // the cost of the path is the distance; consecutive inserts or deletes
+  // form one gap
+  PhaseTimer timer(Metrics::ALIGNMENT);
+  int distance = 0;
+  string first_aligned, second_aligned;
+  first_aligned.reserve(path.size());
+  second_aligned.reserve(path.size());
+  int i = 0, j = 0;
+  for (unsigned int k = 0; k < path.size(); k++) {
+    if (path[k] == 3) {
+      distance += table_[firstCodes_[i] * symbols_ + secondCodes_[j]];
+      first_aligned += first_[i++];
+      second_aligned += second_[j++];
+      continue;
+    }
+    distance += gapExtend_;
+    if (k == 0 || path[k - 1] != path[k]) distance += gapOpen_;
+    if (path[k] == 1) {
+      first_aligned += first_[i++];
+      second_aligned += '-';
+    } else {
+      first_aligned += '-';
+      second_aligned += second_[j++];
+    }
+  }
+  return make_pair(distance, make_pair(first_aligned, second_aligned));
+}
+
+/*
+  Fills lastH and lastE with the costs of the last column of the n x m
+  matrix of codes a and b: of any path and of paths ending with an insert.
+  With reverse set both strings are read backwards, so the costs are those
+  of the paths from each row of the first column to the bottom right cell
+  of the unreversed matrix, row n - i at index i. gapAtStart is the gap
+  condition at the path's start in the direction of reading: forwards, an
+  insert gap left open by the previous range that may continue for free;
+  backwards, that the path has to end with an insert. The reversed codes
+  and the kernel's memory come from scratch.
+*/
+void AffineEditDistance::sweep(const uint8_t* a, int n, const uint8_t* b,
+                               int m, bool reverse, bool gapAtStart,
+                               vector<int>& lastH, vector<int>& lastE,
+                               Scratch& scratch) const {
+  if (reverse) {
+    scratch.reversedFirst.assign(a, a + n);
+    scratch.reversedSecond.assign(b, b + m);
+    std::reverse(scratch.reversedFirst.begin(), scratch.reversedFirst.end());
+    std::reverse(scratch.reversedSecond.begin(), scratch.reversedSecond.end());
+    a = scratch.reversedFirst.data();
+    b = scratch.reversedSecond.data();
+  }
+
+  lastH.resize(n + 1);
+  lastE.resize(n + 1);
+  AffineEditDistanceProblem problem = {
+      a, n, b, m, table_.data(), symbols_, gapOpen_, gapExtend_, 0,
+      AFFINE_BLOCKED, lastH.data(), lastE.data()};
+  if (!reverse && gapAtStart) {
+    problem.insertStart = 0;
+  } else if (reverse && gapAtStart) {
+    // the first insert read backwards is the last one of the path, which
+    // opens the gap the next range continues
+    problem.corner = AFFINE_BLOCKED;
+    problem.insertStart = gapOpen_;
+  }
+  runAffineKernel(problem, scratch.kernel);
+}
+
+/*
+  Appends the edit operations of an optimal alignment of the n codes of a
+  with the m codes of b to path, in forward order: 1 deletes a code of a, 2
+  inserts one of b, 3 replaces or matches.
+  The path through the middle column of b is found from a forward sweep of
+  the left half and a backward sweep of the right half. It either crosses
+  the column at a row minimizing the sum of both halves' costs, or it does
+  so inside an insert gap spanning both halves, whose opening cost both
+  sweeps count and which is charged once (Myers and Miller). Both halves are
+  then aligned recursively with that gap condition at the split - in
+  parallel when more than one thread is available.
+  startInInsert lets a leading insert gap continue one of the previous range
+  for free; endInInsert requires the path to end with an insert.
+  The sweeps' columns are only needed until the split is found, so the
+  recursion reuses the buffers of scratch; a started thread works in a
+  scratch of its own.
+*/
+void AffineEditDistance::alignRange(const uint8_t* a, int n, const uint8_t* b,
+                                    int m, bool startInInsert,
+                                    bool endInInsert, int threads,
+                                    vector<int>& path, Scratch& scratch) const {
+  if (n == 0 || m <= 1 || (long long)n * m <= LEAF_CELLS) {
+    alignLeaf(a, n, b, m, startInInsert, endInInsert, path, scratch);
+    return;
+  }
+
+  int mid = m / 2;
+  vector<int>& forwardH = scratch.forwardH;
+  vector<int>& forwardE = scratch.forwardE;
+  vector<int>& backwardH = scratch.backwardH;
+  vector<int>& backwardE = scratch.backwardE;
+  Scratch workerScratch;
+  if (threads > 1) {
+    thread worker([&]() {
+      PhaseTimer cpu(Metrics::FILL, false);
+      sweep(a, n, b, mid, false, startInInsert, forwardH, forwardE,
+            workerScratch);
+    });
+    sweep(a, n, b + mid, m - mid, true, endInInsert, backwardH, backwardE,
+          scratch);
+    worker.join();
+  } else {
+    sweep(a, n, b, mid, false, startInInsert, forwardH, forwardE, scratch);
+    sweep(a, n, b + mid, m - mid, true, endInInsert, backwardH, backwardE,
+          scratch);
+  }
+
+  int split = 0;
+  bool insertSplit = false;
+  long long best = (long long)AFFINE_BLOCKED * 2;
+  for (int i = 0; i <= n; i++) {
+    long long through = (long long)forwardH[i] + backwardH[n - i];
+    if (through < best) {
+      best = through;
+      split = i;
+      insertSplit = false;
+    }
+    if (forwardE[i] < AFFINE_BLOCKED && backwardE[n - i] < AFFINE_BLOCKED) {
+      long long joined = (long long)forwardE[i] + backwardE[n - i] - gapOpen_;
+      if (joined < best) {
+        best = joined;
+        split = i;
+        insertSplit = true;
+      }
+    }
+  }
+
+  if (threads > 1) {
+    vector<int> second;
+    thread worker([&]() {
+      PhaseTimer cpu(Metrics::FILL, false);
+      alignRange(a + split, n - split, b + mid, m - mid, insertSplit,
+                 endInInsert, threads - threads / 2, second, workerScratch);
+    });
+    alignRange(a, split, b, mid, startInInsert, insertSplit, threads / 2, path,
+               scratch);
+    worker.join();
+    path.insert(path.end(), second.begin(), second.end());
+  } else {
+    alignRange(a, split, b, mid, startInInsert, insertSplit, 1, path, scratch);
+    alignRange(a + split, n - split, b + mid, m - mid, insertSplit,
+               endInInsert, 1, path, scratch);
+  }
+}
+
+/*
+  Aligns a small range with the three full Gotoh matrices, under the gap
+  conditions of alignRange(), and appends its operations to path in
+  forward order. The matrices live in scratch; every cell is written before
+  it is read.
+*/
+void AffineEditDistance::alignLeaf(const uint8_t* a, int n, const uint8_t* b,
+                                   int m, bool startInInsert, bool endInInsert,
+                                   vector<int>& path, Scratch& scratch) const {
+  int width = m + 1;
+  int first = addCost(gapOpen_, gapExtend_);
+  size_t cells = (size_t)(n + 1) * width;
+  if (scratch.leafH.size() < cells) {
+    scratch.leafH.resize(cells);
+    scratch.leafE.resize(cells);
+    scratch.leafF.resize(cells);
+  }
+  int* H = scratch.leafH.data();
+  int* E = scratch.leafE.data();
+  int* F = scratch.leafF.data();
+  H[0] = 0;
+  E[0] = startInInsert ? 0 : AFFINE_BLOCKED;
+  F[0] = AFFINE_BLOCKED;
+  for (int i = 0; i <= n; i++) {
+    for (int j = 0; j <= m; j++) {
+      int at = i * width + j;
+      if (at == 0) continue;
+      E[at] = j > 0 ? min(addCost(E[at - 1], gapExtend_), addCost(H[at - 1], first))
+                    : AFFINE_BLOCKED;
+      F[at] = i > 0 ? min(addCost(F[at - width], gapExtend_),
+                          addCost(H[at - width], first))
+                    : AFFINE_BLOCKED;
+      H[at] = min(E[at], F[at]);
+      if (i > 0 && j > 0) {
+        H[at] = min(H[at], addCost(H[at - width - 1],
+                                   table_[a[i - 1] * symbols_ + b[j - 1]]));
+      }
+    }
+  }
+
+  // 0: any path, 1: ending with a delete, 2: ending with an insert
+  int first_op = path.size();
+  int state = endInInsert ? 2 : 0;
+  int i = n, j = m;
+  while (i > 0 || j > 0) {
+    int at = i * width + j;
+    if (state == 0) {
+      if (i > 0 && j > 0 &&
+          H[at] == addCost(H[at - width - 1],
+                           table_[a[i - 1] * symbols_ + b[j - 1]])) {
+        path.push_back(3);
+        i--;
+        j--;
+      } else {
+        state = H[at] == E[at] ? 2 : 1;
+      }
+    } else if (state == 2) {
+      path.push_back(2);
+      if (E[at] != addCost(E[at - 1], gapExtend_)) state = 0;
+      j--;
+    } else {
+      path.push_back(1);
+      if (F[at] != addCost(F[at - width], gapExtend_)) state = 0;
+      i--;
+    }
+  }
+  reverse(path.begin() + first_op, path.end());
+}
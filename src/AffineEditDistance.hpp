@@ -0,0 +1,125 @@
+#ifndef AFFINEEDITDISTANCE_HPP
+#define AFFINEEDITDISTANCE_HPP
+
+#include <stdint.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+/*
+Edit distance with affine gap costs (Gotoh): a run of k inserted or deleted
+characters costs gapOpen + k * gapExtend, so one long gap is cheaper than
+the same characters scattered over several. Replacements cost the mismatch
+cost unless changed per byte pair with setCosts(), matches cost 0.
+Every cell keeps three states: the best cost of any path to it, of paths
+ending with an insert and of paths ending with a delete.
+calculate() only computes the distance, on a striped SIMD kernel (see
+AffineEditDistanceKernel.hpp) picked like the ones of BasicEditDistance, in
+memory linear in the string lengths. calculate_with_path() also aligns the
+strings in linear memory (see alignRange) at about twice the cost.
+*/
+class AffineEditDistance {
+ public:
+  AffineEditDistance(const string& first, const string& second,
+                     int gapOpen = 3, int gapExtend = 1, int mismatch = 1);
+
+  // replaces the strings, keeping the costs
+  void setStrings(const string& first, const string& second);
+  void setGapCosts(int gapOpen, int gapExtend);
+  // restores the default replacement costs: 0 for a match, mismatch
+  // otherwise
+  void setMismatch(int mismatch);
+  // cost of replacing byte c1 of the first string by byte c2 of the second
+  void setCosts(int c1, int c2, int value);
+  int getCost(int c1, int c2) const;
+  // number of threads of calculate_with_path(); 0 uses every core
+  void setThreads(int threads);
+
+  int calculate();
+  // the distance and both strings aligned, in memory linear in their lengths
+  pair<int, pair<string, string> > calculate_with_path();
+
+ private:
+  string first_, second_;
+  int gapOpen_, gapExtend_, mismatch_;
+  // 256 x 256 replacement costs, only allocated once a cost is changed
+  vector<int> costs_;
+  int threads_;
+
+  // dense codes of both strings and the symbols x symbols replacement costs
+  // of the symbols they use
+  vector<uint8_t> firstCodes_, secondCodes_;
+  vector<int32_t> table_;
+  int symbols_;
+
+  /*
+    Buffers of one thread of calculate_with_path(), which only grow: the
+    kernel's scratch memory, the reversed codes of backward sweeps, the last
+    columns of both sweeps and the matrices of a leaf. The engine keeps one
+    for its calls, so it is reused from pair to pair; threads started by
+    alignRange() get their own.
+  */
+  struct Scratch {
+    vector<uint8_t> kernel;
+    vector<uint8_t> reversedFirst, reversedSecond;
+    vector<int> forwardH, forwardE, backwardH, backwardE;
+    vector<int> leafH, leafE, leafF;
+  };
+  Scratch scratch_;
+
+  // largest range alignRange() aligns with a full matrix
+  static const int LEAF_CELLS = 1 << 16;
+
+  void encode();
+  void sweep(const uint8_t* a, int n, const uint8_t* b, int m, bool reverse,
+             bool gapAtStart, vector<int>& lastH, vector<int>& lastE,
+             Scratch& scratch) const;
+  void alignRange(const uint8_t* a, int n, const uint8_t* b, int m,
+                  bool startInInsert, bool endInInsert, int threads,
+                  vector<int>& path, Scratch& scratch) const;
+  void alignLeaf(const uint8_t* a, int n, const uint8_t* b, int m,
+                 bool startInInsert, bool endInInsert, vector<int>& path,
+                 Scratch& scratch) const;
+};
+
+/*
+Input of the affine kernels: both strings as dense codes, the symbols x
+symbols replacement costs, row major, and the gap costs. The first string
+runs down the rows and the second along the columns. corner is the cost of
+the top left cell, 0 or AFFINE_BLOCKED to forbid starting there other than
+with an insert; insertStart is the cost of paths ending with an insert at
+the top left cell: 0 to continue an open gap for free, gapOpen to make the
+path start with an insert when corner is blocked, or AFFINE_BLOCKED.
+Kernels return the cost of the bottom right cell. With lastH and lastE set
+they also fill rows + 1 costs of the last column: of any path and of paths
+ending with an insert. The SIMD kernels take
+stripedScratchSize(rows, second, columns, 3) bytes of scratch memory (see
+StripedScratch.hpp).
+*/
+#define AFFINE_BLOCKED 0x3FFFFFFF
+
+struct AffineEditDistanceProblem {
+  const uint8_t* first;
+  int rows;
+  const uint8_t* second;
+  int columns;
+  const int32_t* cost;
+  int symbols;
+  int gapOpen;
+  int gapExtend;
+  int corner;
+  int insertStart;
+  int* lastH;
+  int* lastE;
+};
+
+int affineEditDistanceScalar(const AffineEditDistanceProblem& problem);
+int affineEditDistanceSse42(const AffineEditDistanceProblem& problem,
+                            bool wide, uint8_t* scratch);
+int affineEditDistanceAvx2(const AffineEditDistanceProblem& problem, bool wide,
+                           uint8_t* scratch);
+
+#endif
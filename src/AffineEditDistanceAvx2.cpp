@@ -0,0 +1,10 @@
+#include "AffineEditDistance.hpp"
+#include "AffineEditDistanceKernel.hpp"
+#include "StripedKernelOps.hpp"
+
+// striped affine kernel for AVX2; built with -mavx2
+int affineEditDistanceAvx2(const AffineEditDistanceProblem& problem,
+                           bool wide, uint8_t* scratch) {
+  return wide ? stripedAffineEditDistance<Avx2Wide>(problem, scratch)
+              : stripedAffineEditDistance<Avx2Narrow>(problem, scratch);
+}
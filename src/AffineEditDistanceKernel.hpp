@@ -0,0 +1,157 @@
+#ifndef AFFINEEDITDISTANCEKERNEL_HPP
+#define AFFINEEDITDISTANCEKERNEL_HPP
+
+#include <stdint.h>
+
+#include "AffineEditDistance.hpp"
+#include "StripedScratch.hpp"
+
+/*
+Farrar's striped Gotoh recurrence over a table of code costs (see
+AffineEditDistanceProblem), shared by the SIMD kernels of
+AffineEditDistance. Ops is one of the vector types of StripedKernelOps.hpp.
+The first string runs down the rows in striped order, like
+stripedEditDistance(): with seg vectors per column, vector s holds rows s,
+seg + s, 2 * seg + s, ... Each column keeps the costs of any path (H) and of
+paths ending with an insert (E, which only depends on the previous column)
+in memory; the costs of paths ending with a delete (F) run down the rows and
+are carried across lane boundaries by Farrar's lazy F loop, which stops once
+no F can still lower an H or reach further than a freshly opened gap.
+The caller passes stripedScratchSize(rows, second, columns, 3) bytes of
+scratch memory. Only the kernel translation units include this header, and
+the template is internal to each of them.
+*/
+template <class Ops>
+static int stripedAffineEditDistance(const AffineEditDistanceProblem& problem,
+                                     uint8_t* scratch) {
+  typedef typename Ops::V V;
+  typedef typename Ops::Score Score;
+  const int LANES = Ops::LANES;
+
+  int n = problem.rows;
+  int m = problem.columns;
+  const uint8_t* first = problem.first;
+  const uint8_t* second = problem.second;
+  long long open = problem.gapOpen;
+  long long extend = problem.gapExtend;
+  long long corner = problem.corner;
+  // the top row is a single insert gap, the left column a single delete gap
+  long long topStart = problem.insertStart < corner + open
+                            ? problem.insertStart
+                            : corner + open;
+  auto top = [&](int j) -> long long {
+    if (j == 0) return corner;
+    return topStart >= AFFINE_BLOCKED ? AFFINE_BLOCKED : topStart + j * extend;
+  };
+  auto left = [&](int i) -> long long {
+    if (i == 0) return corner;
+    return corner >= AFFINE_BLOCKED ? AFFINE_BLOCKED : corner + open + i * extend;
+  };
+  // scalar costs as lane scores, and back
+  auto lane = [](long long x) -> int {
+    return x >= Ops::INF ? Ops::INF : (int)x;
+  };
+  auto cost = [](long long x) -> int {
+    return x >= Ops::INF || x >= AFFINE_BLOCKED ? AFFINE_BLOCKED : (int)x;
+  };
+
+  if (n == 0 || m == 0) {
+    if (problem.lastH != NULL) {
+      for (int i = 0; i <= n; i++) {
+        problem.lastH[i] = cost(m == 0 ? left(i) : top(m));
+        problem.lastE[i] =
+            i > 0 ? AFFINE_BLOCKED : m == 0 ? problem.insertStart : cost(top(m));
+      }
+    }
+    return cost(m == 0 ? left(n) : top(m));
+  }
+  int seg = (n + LANES - 1) / LANES;
+  int size = seg * LANES;
+
+  // one substitution profile per symbol of second
+  int* profileIndex = (int*)scratch;
+  for (int c = 0; c < problem.symbols; c++) profileIndex[c] = -1;
+  int profiles = 0;
+  for (int j = 0; j < m; j++) {
+    if (profileIndex[second[j]] < 0) profileIndex[second[j]] = profiles++;
+  }
+
+  // striped columns, stored as plain scores like in stripedEditDistance();
+  // padding rows past the end cost nothing and only precede other padding
+  Score* h = (Score*)(scratch + STRIPED_INDEX_BYTES);
+  Score* inserts = h + size;
+  Score* nextInserts = inserts + size;
+  Score* profile = nextInserts + size;
+  for (int s = 0; s < size * (profiles + 3); s++) h[s] = 0;
+  for (int i = 0; i < n; i++) {
+    int at = (i % seg) * LANES + i / seg;
+    const int32_t* replaces = problem.cost + first[i] * problem.symbols;
+    for (int c = 0; c < problem.symbols; c++) {
+      if (profileIndex[c] >= 0) {
+        profile[profileIndex[c] * size + at] = (Score)replaces[c];
+      }
+    }
+    // column 0 is a delete gap; the inserts of column 1 open after it
+    h[at] = (Score)lane(left(i + 1));
+    inserts[at] = (Score)lane(left(i + 1) + open + extend);
+  }
+
+  V inf = Ops::set1(Ops::INF);
+  V gapOpen = Ops::set1(lane(open));
+  V gapExtend = Ops::set1(lane(extend));
+  V gapFirst = Ops::set1(lane(open + extend));
+  for (int j = 1; j <= m; j++) {
+    const Score* costs = &profile[profileIndex[second[j - 1]] * size];
+
+    // the row above each lane's first row: the top row for lane 0, the last
+    // row of the previous lane otherwise
+    V diagonal = Ops::shiftIn(Ops::load(&h[size - LANES]), lane(top(j - 1)));
+    V f = Ops::shiftIn(inf, lane(top(j) + open + extend));
+
+    V current = inf;
+    for (int s = 0; s < size; s += LANES) {
+      V above = Ops::load(&h[s]);
+      V insert = Ops::load(inserts + s);
+      current = Ops::min(Ops::adds(diagonal, Ops::load(costs + s)), insert);
+      current = Ops::min(current, f);
+      Ops::store(&h[s], current);
+      Ops::store(nextInserts + s, Ops::min(Ops::adds(insert, gapExtend),
+                                           Ops::adds(current, gapFirst)));
+      f = Ops::min(Ops::adds(f, gapExtend), Ops::adds(current, gapFirst));
+      diagonal = above;
+    }
+
+    // lazy F: carry deletes across lane boundaries until nothing changes
+    f = Ops::shiftIn(f, Ops::INF);
+    for (int s = 0; Ops::anyLess(f, Ops::adds(Ops::load(&h[s]), gapOpen));) {
+      current = Ops::min(Ops::load(&h[s]), f);
+      Ops::store(&h[s], current);
+      Ops::store(nextInserts + s, Ops::min(Ops::load(nextInserts + s),
+                                           Ops::adds(current, gapFirst)));
+      // gaps opened at unchanged cells were carried by the first pass
+      f = Ops::adds(f, gapExtend);
+      s += LANES;
+      if (s == size) {
+        s = 0;
+        f = Ops::shiftIn(f, Ops::INF);
+      }
+    }
+    Score* swapped = inserts;
+    inserts = nextInserts;
+    nextInserts = swapped;
+  }
+
+  // after the swap nextInserts holds the inserts of the last column
+  if (problem.lastH != NULL) {
+    problem.lastH[0] = cost(top(m));
+    problem.lastE[0] = cost(top(m));
+    for (int i = 1; i <= n; i++) {
+      int at = ((i - 1) % seg) * LANES + (i - 1) / seg;
+      problem.lastH[i] = cost(h[at]);
+      problem.lastE[i] = cost(nextInserts[at]);
+    }
+  }
+  return cost(h[((n - 1) % seg) * LANES + (n - 1) / seg]);
+}
+
+#endif
@@ -0,0 +1,10 @@
+#include "AffineEditDistance.hpp"
+#include "AffineEditDistanceKernel.hpp"
+#include "StripedKernelOps.hpp"
+
+// striped affine kernel for SSE4.2; built with -msse4.2
+int affineEditDistanceSse42(const AffineEditDistanceProblem& problem,
+                            bool wide, uint8_t* scratch) {
+  return wide ? stripedAffineEditDistance<Sse42Wide>(problem, scratch)
+              : stripedAffineEditDistance<Sse42Narrow>(problem, scratch);
+}
@@ -1,74 +1,336 @@
 #include "BasicEditDistance.hpp"
 
-BasicEditDistance::BasicEditDistance(string startingString,
-                                     string targetString) {
-  first = startingString;
-  second = targetString;
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <limits>
 
-  reset();
+#include "StripedScratch.hpp"
+
+// scores of the 16-bit kernels saturate at 0xFFFF, those of the 32-bit ones
+// start at 0x3FFFFFFF
+#define EDIST_NARROW_LIMIT 0xFFFFLL
+#define EDIST_WIDE_LIMIT 0x3FFFFFFFLL
+
+BasicEditDistanceKernels::Kernel BasicEditDistanceKernels::forcedKernel_ =
+    BasicEditDistanceKernels::KERNEL_AUTO;
+
+void BasicEditDistanceKernels::setKernel(Kernel kernel) {
+  forcedKernel_ = kernel;
+}
+
+BasicEditDistanceKernels::Kernel BasicEditDistanceKernels::getKernel() {
+  static const bool avx2 = __builtin_cpu_supports("avx2");
+  static const bool sse42 = __builtin_cpu_supports("sse4.2");
+
+  if (forcedKernel_ == KERNEL_SCALAR) return KERNEL_SCALAR;
+  if (forcedKernel_ == KERNEL_SSE42 && sse42) return KERNEL_SSE42;
+  if (forcedKernel_ == KERNEL_AVX2 && avx2) return KERNEL_AVX2;
+  return avx2 ? KERNEL_AVX2 : sse42 ? KERNEL_SSE42 : KERNEL_SCALAR;
+}
+
+const char* BasicEditDistanceKernels::getKernelName(Kernel kernel) {
+  switch (kernel) {
+    case KERNEL_AVX2:
+      return "AVX2";
+    case KERNEL_SSE42:
+      return "SSE4.2";
+    case KERNEL_SCALAR:
+      return "scalar";
+    default:
+      return "auto";
+  }
+}
+
+// cost of a cell outside the band of calculate(maxDistance); adding any cost
+// to it must not overflow
+template <class Score>
+static Score unreachable() {
+  if (numeric_limits<Score>::has_infinity) {
+    return numeric_limits<Score>::infinity();
+  }
+  return numeric_limits<Score>::max() / 2;
 }
 
-void BasicEditDistance::reset() {
-  result = -1;
+template <class Score>
+BasicEditDistance<Score>::BasicEditDistance(const string& startingString,
+                                            const string& targetString)
+    : symbols_(0) {
+  setStrings(startingString, targetString);
+}
+
+template <class Score>
+void BasicEditDistance<Score>::setStrings(const string& startingString,
+                                          const string& targetString) {
+  first_ = startingString;
+  second_ = targetString;
+  calculated_ = false;
+}
 
-  /* set up basic costs:
-  Replace(i, j) = 2 (for i != j)
+template <class Score>
+void BasicEditDistance<Score>::reset() {
+  /* basic costs:
+  Replace(i, j) = 1 (for i != j)
   Delete = Insert = 1
   */
-  for (int i = 0; i < 255; i++) {
-    for (int j = i + 1; j < 256; j++) {
-      setCosts(i, j, !!(!!i + !!j), true);
-    }
-    setCosts(i, i, 0);
-  }
+  costs_.clear();
+  tableBytes_.clear();
+  calculated_ = false;
 }
 
-void BasicEditDistance::setCosts(int c1, int c2, float value,
-                                 bool mirror_cost) {
-  cost[c1][c2] = value;
+template <class Score>
+void BasicEditDistance<Score>::setCosts(int c1, int c2, Score value,
+                                        bool mirror_cost) {
+  if (costs_.empty()) {
+    costs_.resize(256 * 256);
+    for (int i = 0; i < 256; i++) {
+      for (int j = 0; j < 256; j++) {
+        costs_[i * 256 + j] = i != j;
+      }
+    }
+  }
+  costs_[(unsigned char)c1 * 256 + (unsigned char)c2] = value;
 
   if (mirror_cost) {
-    cost[c2][c1] = value;
+    costs_[(unsigned char)c2 * 256 + (unsigned char)c1] = value;
   }
+  tableBytes_.clear();
+  calculated_ = false;
+}
+
+template <class Score>
+Score BasicEditDistance<Score>::getCost(int c1, int c2) const {
+  unsigned char a = c1;
+  unsigned char b = c2;
+  if (costs_.empty()) return a != b;
+  return costs_[a * 256 + b];
 }
 
-float BasicEditDistance::getResult() {
-  if (!~result) {
+template <class Score>
+Score BasicEditDistance<Score>::getResult() {
+  if (!calculated_) {
     calculate();
   }
 
-  return result;
+  return result_;
+}
+
+/*
+  Gives every byte used by either string a dense code, the blank byte code
+  0, and gathers the costs of those codes into table_ unless it already
+  holds them.
+*/
+template <class Score>
+void BasicEditDistance<Score>::encode() {
+  int codes[256];
+  for (int c = 0; c < 256; c++) codes[c] = -1;
+  uint8_t bytes[256];
+  codes[EDIST_BLANK] = 0;
+  bytes[0] = EDIST_BLANK;
+  symbols_ = 1;
+
+  firstCodes_.resize(first_.size());
+  for (unsigned int i = 0; i < first_.size(); i++) {
+    unsigned char c = first_[i];
+    if (codes[c] < 0) {
+      bytes[symbols_] = c;
+      codes[c] = symbols_++;
+    }
+    firstCodes_[i] = codes[c];
+  }
+  secondCodes_.resize(second_.size());
+  for (unsigned int j = 0; j < second_.size(); j++) {
+    unsigned char c = second_[j];
+    if (codes[c] < 0) {
+      bytes[symbols_] = c;
+      codes[c] = symbols_++;
+    }
+    secondCodes_[j] = codes[c];
+  }
+
+  if (tableBytes_.size() == (size_t)symbols_ &&
+      memcmp(tableBytes_.data(), bytes, symbols_) == 0) {
+    return;
+  }
+  tableBytes_.assign(bytes, bytes + symbols_);
+  kernelCosts_.clear();
+  table_.resize(symbols_ * symbols_);
+  for (int a = 0; a < symbols_; a++) {
+    for (int b = 0; b < symbols_; b++) {
+      table_[a * symbols_ + b] = getCost(bytes[a], bytes[b]);
+    }
+  }
+}
+
+template <class Score>
+Score BasicEditDistance<Score>::calculate() {
+  encode();
+  calculated_ = true;
+
+  Kernel kernel = getKernel();
+  long long bound = kernel == KERNEL_SCALAR ? -1 : integralScoreBound();
+  if (bound < 0 || bound >= EDIST_WIDE_LIMIT) {
+    calculateScalar();
+    return result_;
+  }
+
+  if (kernelCosts_.empty()) kernelCosts_.assign(table_.begin(), table_.end());
+  BasicEditDistanceProblem problem = {
+      firstCodes_.data(), (int)firstCodes_.size(), secondCodes_.data(),
+      (int)secondCodes_.size(), kernelCosts_.data(), symbols_};
+  bool wide = bound >= EDIST_NARROW_LIMIT;
+  size_t scratch = stripedScratchSize(problem.rows, problem.second,
+                                      problem.columns, 2);
+  if (scratch_.size() < scratch) scratch_.resize(scratch);
+  if (kernel == KERNEL_AVX2) {
+    result_ = basicEditDistanceAvx2(problem, wide, scratch_.data());
+  } else {
+    result_ = basicEditDistanceSse42(problem, wide, scratch_.data());
+  }
+  return result_;
+}
+
+/*
+  Every cell is at most the cost of deleting its whole prefix of first and
+  inserting its whole prefix of second, and the kernels add one more cost to
+  a cell before taking minima, so that sum plus the largest cost bounds every
+  score they see.
+*/
+template <class Score>
+long long BasicEditDistance<Score>::integralScoreBound() const {
+  double largest = 0;
+  for (int i = 0; i < symbols_ * symbols_; i++) {
+    double value = table_[i];
+    if (!(value >= 0) || value != floor(value) || value >= EDIST_WIDE_LIMIT) {
+      return -1;
+    }
+    largest = max(largest, value);
+  }
+
+  long long bound = (long long)largest;
+  for (unsigned int i = 0; i < firstCodes_.size(); i++) {
+    bound += (long long)table_[firstCodes_[i] * symbols_];
+  }
+  for (unsigned int j = 0; j < secondCodes_.size(); j++) {
+    bound += (long long)table_[secondCodes_[j]];
+  }
+  return bound;
+}
+
+template <class Score>
+void BasicEditDistance<Score>::calculateScalar() {
+  int n = firstCodes_.size();
+  int m = secondCodes_.size();
+  // alternating the rows uses O(m) instead of O(n*m) memory
+  rows_.resize(2 * (m + 1));
+  Score* previous = &rows_[0];
+  Score* current = &rows_[m + 1];
+  // inserts are the blank row of the table, deletes its blank column
+  const Score* inserts = &table_[0];
+  const uint8_t* second = secondCodes_.data();
+
+  // the starting state and the insertion cost partial sums (when we have
+  // extra characters in the target string)
+  previous[0] = 0;
+  for (int j = 1; j <= m; j++) {
+    previous[j] = previous[j - 1] + inserts[second[j - 1]];
+  }
+
+  for (int i = 1; i <= n; i++) {
+    const Score* replaces = &table_[firstCodes_[i - 1] * symbols_];
+    Score remove = replaces[0];
+    current[0] = previous[0] + remove;
+    for (int j = 1; j <= m; j++) {
+      current[j] = min(min(previous[j - 1] + replaces[second[j - 1]],  // replace
+                           previous[j] + remove),                     // delete
+                       current[j - 1] + inserts[second[j - 1]]);      // insert
+    }
+    swap(previous, current);
+  }
+
+  result_ = previous[m];
 }
 
-void BasicEditDistance::calculate() {
-  // the starting state
-  dp[0][0] = 0;
+/*
+  Computes the distance if it is at most maxDistance and returns
+  maxDistance + 1 otherwise. Every gap costs at least the cheapest insert or
+  delete, so cells further than maxDistance / (cheapest gap) from the
+  diagonal cannot be on a path within the bound and are skipped; the
+  calculation stops at the first row whose cells all exceed the bound.
+*/
+template <class Score>
+Score BasicEditDistance<Score>::calculate(Score maxDistance) {
+  encode();
+  int n = firstCodes_.size();
+  int m = secondCodes_.size();
+  const Score infinity = unreachable<Score>();
+
+  Score minGap = infinity;
+  for (int c = 1; c < symbols_; c++) {
+    minGap = min(minGap, min(table_[c * symbols_], table_[c]));
+  }
+  // without a positive gap cost every cell is reachable within the bound
+  int band = minGap > 0 ? int(min(double(maxDistance) / minGap, double(n + m)))
+                        : n + m;
+  if (maxDistance < 0 || abs(n - m) > band) {
+    return maxDistance + 1;
+  }
 
-  // insertion cost partial sums (when we have extra characters in the target
-  // string
-  for (unsigned int i = 1; i <= second.size(); i++) {
-    dp[0][i] = dp[0][i - 1] + cost[EDIST_BLANK][int(second[i - 1])];
+  // cells outside the band hold an infinite cost
+  rows_.resize(2 * (m + 1));
+  Score* previous = &rows_[0];
+  Score* current = &rows_[m + 1];
+  const Score* inserts = &table_[0];
+  const uint8_t* second = secondCodes_.data();
+  previous[0] = 0;
+  for (int j = 1; j <= min(m, band); j++) {
+    previous[j] = previous[j - 1] + inserts[second[j - 1]];
   }
+  if (band < m) previous[band + 1] = infinity;
+
+  for (int i = 1; i <= n; i++) {
+    const Score* replaces = &table_[firstCodes_[i - 1] * symbols_];
+    Score remove = replaces[0];
+    int low = max(0, i - band);
+    int high = min(m, i + band);
+    Score rowMin = infinity;
 
-  int alt = 1;  // alternating the rows uses O(m) instead of O(n*m) memory
-  for (unsigned int i = 1; i <= first.size(); i++, alt = !alt) {
-    dp[alt][0] = cost[int(first[i - 1])][EDIST_BLANK] + dp[!alt][0];
-    for (unsigned int j = 1; j <= second.size(); j++) {
-      dp[alt][j] = min(
-          min(dp[!alt][j - 1] + cost[int(first[i - 1])][int(second[j - 1])],  // replace
-              dp[!alt][j] + cost[int(first[i - 1])][EDIST_BLANK]),       // delete
-          dp[alt][j - 1] + cost[EDIST_BLANK][int(second[i - 1])]);       // insert
+    if (low == 0) {
+      current[0] = previous[0] + remove;
+      rowMin = current[0];
+      low = 1;
+    } else {
+      current[low - 1] = infinity;
+    }
+    for (int j = low; j <= high; j++) {
+      current[j] = min(min(previous[j - 1] + replaces[second[j - 1]],  // replace
+                           previous[j] + remove),                     // delete
+                       current[j - 1] + inserts[second[j - 1]]);      // insert
+      rowMin = min(rowMin, current[j]);
+    }
+    if (high < m) current[high + 1] = infinity;
+    swap(previous, current);
+
+    // every path to the last row crosses this one
+    if (rowMin > maxDistance) {
+      return maxDistance + 1;
     }
   }
 
-  result = dp[!alt][second.size()];
+  Score distance = previous[m];
+  return distance <= maxDistance ? distance : maxDistance + 1;
 }
 
+template class BasicEditDistance<int16_t>;
+template class BasicEditDistance<int32_t>;
+template class BasicEditDistance<float>;
+
 /* 'Unit' test
 int main() {
     string first = "testing";
     string second = "rofltest";
-    BasicEditDistance tester(first, second);
+    BasicEditDistance<> tester(first, second);
     cout << tester.getResult() << endl;
     return 0;
 }
@@ -1,26 +1,113 @@
 #ifndef BASICEDITDISTANCE_HPP
 #define BASICEDITDISTANCE_HPP
 
-#define EDIST_MAX_LENGTH 100000
 #define EDIST_BLANK 0
 
+#include <stdint.h>
+
 #include <string>
+#include <vector>
 
 using namespace std;
 
-class BasicEditDistance {
+/*
+Kernel selection shared by every score type of BasicEditDistance.
+*/
+class BasicEditDistanceKernels {
  public:
-  string first, second;
-  int result;
-  float cost[256][256];
-  float dp[2][EDIST_MAX_LENGTH + 1];
+  enum Kernel { KERNEL_AUTO, KERNEL_SCALAR, KERNEL_SSE42, KERNEL_AVX2 };
+
+  // forces a kernel, e.g. for benchmarks; KERNEL_AUTO picks the widest one
+  // the CPU supports. Unsupported kernels fall back to automatic selection.
+  static void setKernel(Kernel kernel);
+  // the kernel calculate() runs on this CPU for integral cost tables
+  static Kernel getKernel();
+  static const char* getKernelName(Kernel kernel);
+
+ private:
+  static Kernel forcedKernel_;
+};
 
-  BasicEditDistance(string startingString, string targetString);
+/*
+Edit distance with a full cost table: getCost(a, b) replaces byte a by byte
+b, and the blank byte EDIST_BLANK stands for the missing side of inserts and
+deletes. Unless changed with setCosts(), matches cost 0 and every other
+operation 1.
+Score is the type of costs and distances (int16_t, int32_t or float); the
+caller picks one wide enough for the distances it expects.
+Before calculating, both strings are encoded as dense byte codes of the
+symbols they use (code 0 is the blank), so the calculation looks costs up in
+a table of only those symbols. The DP rows live on the heap, sized to the
+second string, and are kept for later calls.
+With whole, non-negative costs calculate() runs a striped SIMD kernel (see
+BasicEditDistanceKernel.hpp) on 16-bit lanes, or on 32-bit lanes when the
+distance could exceed them; other cost tables use the scalar loop.
+*/
+template <class Score = int32_t>
+class BasicEditDistance : public BasicEditDistanceKernels {
+ public:
+  BasicEditDistance(const string& startingString, const string& targetString);
 
+  // replaces the strings, keeping the costs and the allocated rows
+  void setStrings(const string& startingString, const string& targetString);
+  // restores the unit costs
   void reset();
-  void setCosts(int c1, int c2, float value, bool mirror_cost = false);
-  float getResult();
-  void calculate();
+  void setCosts(int c1, int c2, Score value, bool mirror_cost = false);
+  Score getCost(int c1, int c2) const;
+  Score getResult();
+  Score calculate();
+  // the distance if at most maxDistance, maxDistance + 1 otherwise
+  Score calculate(Score maxDistance);
+
+ private:
+  string first_, second_;
+  Score result_;
+  bool calculated_;
+  // full 256 x 256 cost table, only allocated once a cost is changed
+  vector<Score> costs_;
+
+  // byte codes of both strings and the cost table of the symbols they use,
+  // symbols_ x symbols_ entries; see encode()
+  vector<uint8_t> firstCodes_, secondCodes_;
+  vector<Score> table_;
+  int symbols_;
+  // the byte of every code table_ was gathered for; cleared when the costs
+  // change, so table_ is only rebuilt for new costs or symbols
+  vector<uint8_t> tableBytes_;
+  // two DP rows of second_.size() + 1 cells
+  vector<Score> rows_;
+  // table_ as the 32-bit costs of the striped kernels, empty until a kernel
+  // needs it after table_ changed, and the kernels' scratch memory, which
+  // only grows
+  vector<int32_t> kernelCosts_;
+  vector<uint8_t> scratch_;
+
+  void encode();
+  void calculateScalar();
+  // largest score the striped kernels may meet, or -1 if the costs the
+  // strings use are not all whole and non-negative
+  long long integralScoreBound() const;
 };
 
+/*
+Input of the striped kernels of BasicEditDistance: both strings as byte
+codes, and the symbols x symbols table of their costs, row major, with code
+0 as the blank. Kernels return the distance; wide selects 32-bit lanes,
+which the caller picks when a score may not fit in 16 bits. scratch holds
+stripedScratchSize(rows, second, columns, 2) bytes (see StripedScratch.hpp).
+*/
+struct BasicEditDistanceProblem {
+  const uint8_t* first;
+  int rows;
+  const uint8_t* second;
+  int columns;
+  const int32_t* cost;
+  int symbols;
+};
+
+int basicEditDistanceSse42(const BasicEditDistanceProblem& problem, bool wide,
+                          uint8_t* scratch);
+int basicEditDistanceAvx2(const BasicEditDistanceProblem& problem, bool wide,
+                         uint8_t* scratch);
+
 #endif
@@ -0,0 +1,10 @@
+#include "BasicEditDistance.hpp"
+#include "BasicEditDistanceKernel.hpp"
+#include "StripedKernelOps.hpp"
+
+// striped kernel for AVX2; built with -mavx2
+int basicEditDistanceAvx2(const BasicEditDistanceProblem& problem, bool wide,
+                         uint8_t* scratch) {
+  return wide ? stripedEditDistance<Avx2Wide>(problem, scratch)
+              : stripedEditDistance<Avx2Narrow>(problem, scratch);
+}
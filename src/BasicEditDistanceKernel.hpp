@@ -0,0 +1,123 @@
+#ifndef BASICEDITDISTANCEKERNEL_HPP
+#define BASICEDITDISTANCEKERNEL_HPP
+
+#include <stdint.h>
+
+#include "BasicEditDistance.hpp"
+#include "StripedScratch.hpp"
+
+/*
+Farrar's striped edit distance over a table of byte code costs (see
+BasicEditDistanceProblem), shared by the SIMD kernels of BasicEditDistance.
+Ops is the vector type of one instruction set and score width, providing:
+  V, LANES, INF          vector type, lanes, saturated "unreachable" value
+  Score                  scalar type of a lane
+  set1(x), load(p), store(p, v)   p points to LANES scores
+  adds(a, b)             addition saturating at INF
+  min(a, b)
+  shiftIn(v, x)          lane k gets lane k - 1, lane 0 gets x
+  anyLess(a, b)          whether a < b in some lane
+The first string runs down the rows in striped order: with seg vectors per
+column, vector s holds rows s, seg + s, 2 * seg + s, ... so a column is a
+run of independent vector operations, except for the deletions running down
+the rows, which are resolved by Farrar's lazy F loop.
+The caller passes stripedScratchSize(rows, second, columns, 2) bytes of
+scratch memory. Only the kernel translation units include this header, and
+the template is internal to each of them.
+*/
+template <class Ops>
+static int stripedEditDistance(const BasicEditDistanceProblem& problem,
+                               uint8_t* scratch) {
+  typedef typename Ops::V V;
+  typedef typename Ops::Score Score;
+  const int LANES = Ops::LANES;
+
+  int n = problem.rows;
+  int m = problem.columns;
+  const unsigned char* first = problem.first;
+  const unsigned char* second = problem.second;
+  const int32_t* cost = problem.cost;
+  int symbols = problem.symbols;
+
+  long long top = 0;
+  if (n == 0) {
+    for (int j = 0; j < m; j++) top += cost[second[j]];
+    return (int)top;
+  }
+  int seg = (n + LANES - 1) / LANES;
+
+  // one substitution profile per symbol of second
+  int* profileIndex = (int*)scratch;
+  for (int c = 0; c < symbols; c++) profileIndex[c] = -1;
+  int profiles = 0;
+  for (int j = 0; j < m; j++) {
+    if (profileIndex[second[j]] < 0) profileIndex[second[j]] = profiles++;
+  }
+
+  // striped rows, stored as plain scores (vectors of LANES) so no alignment
+  // beyond the scratch memory's is needed; padding rows past the end cost
+  // nothing and only precede other padding rows
+  int size = seg * LANES;
+  Score* deletes = (Score*)(scratch + STRIPED_INDEX_BYTES);
+  Score* column = deletes + size;
+  Score* profile = column + size;
+  for (int s = 0; s < size * (profiles + 2); s++) deletes[s] = 0;
+  long long sum = 0;
+  for (int i = 0; i < n; i++) {
+    int at = (i % seg) * LANES + i / seg;
+    const int32_t* replaces = cost + first[i] * symbols;
+    deletes[at] = (Score)replaces[0];
+    for (int c = 0; c < symbols; c++) {
+      if (profileIndex[c] >= 0) {
+        profile[profileIndex[c] * size + at] = (Score)replaces[c];
+      }
+    }
+    // column 0: the cost of deleting every row so far
+    sum += replaces[0];
+    column[at] = (Score)sum;
+  }
+
+  V inf = Ops::set1(Ops::INF);
+  V firstDeletes = Ops::load(&deletes[0]);
+  Score* h = column;
+  for (int j = 0; j < m; j++) {
+    const Score* costs = &profile[profileIndex[second[j]] * size];
+    V inserts = Ops::set1((Score)cost[second[j]]);
+    long long previousTop = top;
+    top += cost[second[j]];
+
+    // the row above each lane's first row: the top row for lane 0, the last
+    // row of the previous lane otherwise
+    V diagonal = Ops::shiftIn(Ops::load(h + size - LANES), (int)previousTop);
+    V f = Ops::adds(Ops::shiftIn(inf, (int)top), firstDeletes);
+
+    V current = inf;
+    for (int s = 0; s < size; s += LANES) {
+      V above = Ops::load(h + s);
+      current = Ops::min(Ops::adds(diagonal, Ops::load(costs + s)),
+                         Ops::adds(above, inserts));
+      current = Ops::min(current, f);
+      Ops::store(h + s, current);
+      diagonal = above;
+      if (s + LANES < size) f = Ops::adds(current, Ops::load(&deletes[s + LANES]));
+    }
+
+    // lazy F: carry deletions across lane boundaries until nothing improves
+    f = Ops::adds(Ops::shiftIn(current, Ops::INF), firstDeletes);
+    for (int s = 0; Ops::anyLess(f, Ops::load(h + s));) {
+      current = Ops::min(Ops::load(h + s), f);
+      Ops::store(h + s, current);
+      s += LANES;
+      if (s == size) {
+        s = 0;
+        f = Ops::adds(Ops::shiftIn(current, Ops::INF), firstDeletes);
+      } else {
+        f = Ops::adds(current, Ops::load(&deletes[s]));
+      }
+    }
+  }
+
+  return (int)column[((n - 1) % seg) * LANES + (n - 1) / seg];
+}
+
+#endif
@@ -0,0 +1,10 @@
+#include "BasicEditDistance.hpp"
+#include "BasicEditDistanceKernel.hpp"
+#include "StripedKernelOps.hpp"
+
+// striped kernel for SSE4.2; built with -msse4.2
+int basicEditDistanceSse42(const BasicEditDistanceProblem& problem, bool wide,
+                          uint8_t* scratch) {
+  return wide ? stripedEditDistance<Sse42Wide>(problem, scratch)
+              : stripedEditDistance<Sse42Narrow>(problem, scratch);
+}
@@ -0,0 +1,82 @@
+#include "BatchEditDistance.hpp"
+
+#include <algorithm>
+
+#include "BitParallelEditDistance.hpp"
+
+BatchEditDistance::BatchEditDistance() {}
+
+int BatchEditDistance::add(const string& first, const string& second) {
+  firsts_.push_back(first);
+  seconds_.push_back(second);
+  return firsts_.size() - 1;
+}
+
+void BatchEditDistance::clear() {
+  firsts_.clear();
+  seconds_.clear();
+  results_.clear();
+}
+
+// orders pairs by their pattern (shorter string) and then text length, so
+// neighbouring lanes have similar numbers of words and columns
+static bool shorterPair(const BatchEditDistancePair& a,
+                        const BatchEditDistancePair& b) {
+  int patternA = min(a.firstLength, a.secondLength);
+  int patternB = min(b.firstLength, b.secondLength);
+  if (patternA != patternB) return patternA < patternB;
+  return max(a.firstLength, a.secondLength) <
+         max(b.firstLength, b.secondLength);
+}
+
+void BatchEditDistance::calculate() {
+  int count = firsts_.size();
+  results_.assign(count, 0);
+
+  BitParallelEditDistance::Kernel kernel = BitParallelEditDistance::getKernel();
+  vector<BatchEditDistancePair> pairs;
+  pairs.reserve(count);
+  for (int i = 0; i < count; i++) {
+    int firstLength = firsts_[i].size();
+    int secondLength = seconds_[i].size();
+    if (max(firstLength, secondLength) > BATCH_MAX_LENGTH) {
+      results_[i] = BitParallelEditDistance(firsts_[i], seconds_[i]).calculate();
+      continue;
+    }
+    BatchEditDistancePair pair = {firsts_[i].data(), firstLength,
+                                  seconds_[i].data(), secondLength, i};
+    pairs.push_back(pair);
+  }
+  if (pairs.empty()) return;
+
+  sort(pairs.begin(), pairs.end(), shorterPair);
+
+  // scratch memory for the largest group: each lane's masks cover at most
+  // one symbol per row, or every byte, plus the one matching nothing
+  int maxRows = 0;
+  int maxColumns = 0;
+  for (unsigned int i = 0; i < pairs.size(); i++) {
+    maxRows = max(maxRows, min(pairs[i].firstLength, pairs[i].secondLength));
+    maxColumns =
+        max(maxColumns, max(pairs[i].firstLength, pairs[i].secondLength));
+  }
+  int words = (maxRows + 63) / 64;
+  vector<uint64_t> peq(
+      max(1, BATCH_MAX_LANES * (min(maxRows, 256) + 1) * words));
+  vector<int> text(BATCH_MAX_LANES * maxColumns);
+  vector<uint64_t> carryPlus(BATCH_MAX_LANES * maxColumns);
+  vector<uint64_t> carryMinus(BATCH_MAX_LANES * maxColumns);
+  BatchEditDistanceScratch scratch = {peq.data(), (int)peq.size(), text.data(),
+                                      carryPlus.data(), carryMinus.data(),
+                                      maxColumns};
+
+  if (kernel == BitParallelEditDistance::KERNEL_AVX2) {
+    batchEditDistanceAvx2(pairs.data(), pairs.size(), scratch, results_.data());
+  } else if (kernel == BitParallelEditDistance::KERNEL_SSE42) {
+    batchEditDistanceSse42(pairs.data(), pairs.size(), scratch,
+                           results_.data());
+  } else {
+    batchEditDistanceScalar(pairs.data(), pairs.size(), scratch,
+                            results_.data());
+  }
+}
@@ -0,0 +1,88 @@
+#ifndef BATCHEDITDISTANCE_HPP
+#define BATCHEDITDISTANCE_HPP
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// longest string calculated in a SIMD lane; longer pairs are calculated one
+// at a time with BitParallelEditDistance, which spreads their words over the
+// lanes instead
+#define BATCH_MAX_LENGTH 2048
+// most pairs per group of any batch kernel: AVX2 with four 64-bit lanes
+#define BATCH_MAX_LANES 4
+
+/*
+Unit-cost edit distances of many independent pairs, calculated together
+with one pair per SIMD lane: every lane runs Myers' bit-vector algorithm on
+its own pair, so a single vector operation advances a word of all of them.
+Pairs are sorted by length and grouped so the lanes of a group do similar
+amounts of work. Characters are compared exactly, like
+BitParallelEditDistance, whose kernel selection (setKernel()) this class
+follows.
+*/
+class BatchEditDistance {
+ public:
+  BatchEditDistance();
+
+  // adds a pair and returns its index in the results
+  int add(const string& first, const string& second);
+  void clear();
+  int size() const { return firsts_.size(); }
+
+  // calculates the distances of every pair added so far
+  void calculate();
+  const vector<int>& getResults() const { return results_; }
+
+ private:
+  vector<string> firsts_;
+  vector<string> seconds_;
+  vector<int> results_;
+};
+
+/*
+A pair as seen by the batch kernels, which write the distance to
+results[index].
+*/
+struct BatchEditDistancePair {
+  const char* first;
+  int firstLength;
+  const char* second;
+  int secondLength;
+  int index;
+};
+
+/*
+Scratch memory of the batch kernels, allocated by the caller so the kernel
+units, built for their own instruction sets, instantiate no library
+templates. For groups of up to BATCH_MAX_LANES pairs of at most words
+pattern words and columns text characters each, peq holds peqSize words,
+while text, carryPlus and carryMinus hold BATCH_MAX_LANES * columns entries.
+*/
+struct BatchEditDistanceScratch {
+  uint64_t* peq;
+  int peqSize;
+  int* text;
+  uint64_t* carryPlus;
+  uint64_t* carryMinus;
+  int columns;
+};
+
+/*
+Batch kernels, see BatchEditDistanceKernel.hpp. They take pairs sorted by
+length, none longer than BATCH_MAX_LENGTH, and group consecutive ones.
+*/
+void batchEditDistanceScalar(const BatchEditDistancePair* pairs, int count,
+                             const BatchEditDistanceScratch& scratch,
+                             int* results);
+void batchEditDistanceSse42(const BatchEditDistancePair* pairs, int count,
+                            const BatchEditDistanceScratch& scratch,
+                            int* results);
+void batchEditDistanceAvx2(const BatchEditDistancePair* pairs, int count,
+                           const BatchEditDistanceScratch& scratch,
+                           int* results);
+
+#endif
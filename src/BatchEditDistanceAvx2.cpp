@@ -0,0 +1,9 @@
+#include "BatchEditDistance.hpp"
+#include "BatchEditDistanceKernel.hpp"
+
+// batch kernel with four pairs per vector; built with -mavx2
+void batchEditDistanceAvx2(const BatchEditDistancePair* pairs, int count,
+                           const BatchEditDistanceScratch& scratch,
+                           int* results) {
+  batchKernel<4>(pairs, count, scratch, results);
+}
@@ -0,0 +1,215 @@
+#ifndef BATCHEDITDISTANCEKERNEL_HPP
+#define BATCHEDITDISTANCEKERNEL_HPP
+
+#include <stdint.h>
+
+#include <string.h>
+
+#include "BatchEditDistance.hpp"
+#include "BitParallelKernel.hpp"
+
+/*
+State of one word of every lane while batchGroup() sweeps the columns.
+*/
+template <int LANES>
+struct BatchWord {
+  typedef typename BitParallelLanes<LANES>::type Lanes;
+
+  Lanes pv, mv;
+  // lanes that have this word, and those for which it is the last one
+  Lanes inWord, scoring;
+  Lanes columns, lastBit, score;
+  int word;
+  const uint64_t* peq;
+  const int* text;
+  uint64_t* carryPlus;
+  uint64_t* carryMinus;
+};
+
+/*
+Columns [from, to) of one word. MASKED sweeps keep the state of lanes
+without this word or past the end of their text; SCORE is set when some
+lane scores its last word.
+*/
+template <int LANES, bool MASKED, bool SCORE>
+static void batchColumns(BatchWord<LANES>& group, int from, int to) {
+  typedef typename BitParallelLanes<LANES>::type Lanes;
+
+  BatchWord<LANES> g = group;
+  for (int j = from; j < to; j++) {
+    Lanes eq;
+    for (int l = 0; l < LANES; l++) {
+      eq[l] = g.peq[g.text[j * LANES + l] + g.word];
+    }
+    Lanes hp, hm;
+    memcpy(&hp, &g.carryPlus[j * LANES], sizeof(hp));
+    memcpy(&hm, &g.carryMinus[j * LANES], sizeof(hm));
+
+    Lanes xv = eq | g.mv;
+    eq |= hm;
+    Lanes xh = (((eq & g.pv) + g.pv) ^ g.pv) | eq;
+    Lanes ph = g.mv | ~(xh | g.pv);
+    Lanes mh = g.pv & xh;
+
+    Lanes active = MASKED ? g.inWord & (Lanes)(j < g.columns) : ~(Lanes){0};
+    if (SCORE) {
+      Lanes counted = MASKED ? g.scoring & active : g.scoring;
+      g.score += ((ph >> g.lastBit) & 1 & counted) -
+                 ((mh >> g.lastBit) & 1 & counted);
+    }
+
+    Lanes outPlus = ph >> 63;
+    Lanes outMinus = mh >> 63;
+    memcpy(&g.carryPlus[j * LANES], &outPlus, sizeof(outPlus));
+    memcpy(&g.carryMinus[j * LANES], &outMinus, sizeof(outMinus));
+    ph = (ph << 1) | hp;
+    mh = (mh << 1) | hm;
+    Lanes pv = mh | ~(xv | ph);
+    Lanes mv = ph & xv;
+    if (MASKED) {
+      g.pv = (pv & active) | (g.pv & ~active);
+      g.mv = (mv & active) | (g.mv & ~active);
+    } else {
+      g.pv = pv;
+      g.mv = mv;
+    }
+  }
+  group = g;
+}
+
+/*
+Myers' bit-vector algorithm (see bitParallelKernel()) for LANES pairs at
+once, one pair per 64-bit lane. The shorter string of a pair is its
+pattern. Words of the patterns are processed in lockstep: for word w every
+lane sweeps its own text, taking the carries of word w - 1 from a per-column
+array interleaved lane by lane, so carries move as whole vectors. Lanes
+whose pattern has fewer words, or whose text is shorter, keep their state
+while masked out, and each lane scores the bottom row of its own last word.
+The masks, texts and carries live in the caller's scratch memory.
+Only the kernel translation units include this header, and the template is
+internal to each of them.
+*/
+template <int LANES>
+static void batchGroup(const BatchEditDistancePair* pairs, int count,
+                       const BatchEditDistanceScratch& scratch,
+                       int* results) {
+  typedef typename BitParallelLanes<LANES>::type Lanes;
+
+  Lanes words, columns, lastWord, lastBit, score;
+  Lanes zero = {0};
+  int maxWords = 0;
+  int maxColumns = 0;
+  const char* patterns[LANES];
+  const char* texts[LANES];
+  int patternRows[LANES];
+  for (int l = 0; l < LANES; l++) {
+    int rows = 0;
+    int length = 0;
+    patterns[l] = texts[l] = NULL;
+    if (l < count) {
+      const BatchEditDistancePair& pair = pairs[l];
+      bool swapped = pair.firstLength > pair.secondLength;
+      patterns[l] = swapped ? pair.second : pair.first;
+      texts[l] = swapped ? pair.first : pair.second;
+      rows = swapped ? pair.secondLength : pair.firstLength;
+      length = swapped ? pair.firstLength : pair.secondLength;
+    }
+    patternRows[l] = rows;
+    words[l] = (rows + 63) / 64;
+    columns[l] = length;
+    // lanes with an empty pattern never score; their distance is the text
+    lastWord[l] = words[l] - 1;
+    lastBit[l] = rows > 0 ? (rows - 1) % 64 : 0;
+    score[l] = rows > 0 ? rows : length;
+    if ((int)words[l] > maxWords) maxWords = words[l];
+    if (length > maxColumns) maxColumns = length;
+  }
+
+  // match masks of every lane's pattern over the symbols it uses, the last
+  // symbol matching nothing; text[j * LANES + l] addresses the masks of
+  // column j of lane l
+  uint64_t* peq = scratch.peq;
+  int* text = scratch.text;
+  for (int k = 0; k < maxColumns * LANES; k++) text[k] = 0;
+  int used = 0;
+  for (int l = 0; l < count; l++) {
+    int rows = patternRows[l];
+    int base = used;
+    int codes[256];
+    for (int c = 0; c < 256; c++) codes[c] = -1;
+    int symbols = 0;
+    for (int i = 0; i < rows; i++) {
+      unsigned char c = patterns[l][i];
+      if (codes[c] < 0) codes[c] = symbols++;
+    }
+    used = base + (symbols + 1) * maxWords;
+    for (int k = base; k < used; k++) peq[k] = 0;
+    for (int i = 0; i < rows; i++) {
+      int code = codes[(unsigned char)patterns[l][i]];
+      peq[base + code * maxWords + i / 64] |= 1ULL << (i % 64);
+    }
+    for (int j = 0; j < (int)columns[l]; j++) {
+      int code = codes[(unsigned char)texts[l][j]];
+      text[j * LANES + l] = base + (code < 0 ? symbols : code) * maxWords;
+    }
+  }
+
+  // the first word starts from D[0][j] = j, a +1 delta in every column.
+  // Plain words rather than vectors, which the caller's memory need not align
+  for (int k = 0; k < maxColumns * LANES; k++) {
+    scratch.carryPlus[k] = 1;
+    scratch.carryMinus[k] = 0;
+  }
+
+  BatchWord<LANES> g;
+  g.peq = peq;
+  g.text = text;
+  g.carryPlus = scratch.carryPlus;
+  g.carryMinus = scratch.carryMinus;
+  g.columns = columns;
+  g.lastBit = lastBit;
+  g.score = score;
+  for (int w = 0; w < maxWords; w++) {
+    g.pv = ~zero;
+    g.mv = zero;
+    g.word = w;
+    g.inWord = (Lanes)(w < words);
+    g.scoring = (Lanes)(w == lastWord);
+
+    // columns every lane has, unmasked when every lane has this word
+    int common = maxColumns;
+    bool full = true;
+    bool scores = false;
+    for (int l = 0; l < LANES; l++) {
+      if ((int)columns[l] < common) common = columns[l];
+      full = full && g.inWord[l];
+      scores = scores || g.scoring[l];
+    }
+    if (!full) common = 0;
+    if (scores) {
+      batchColumns<LANES, false, true>(g, 0, common);
+      batchColumns<LANES, true, true>(g, common, maxColumns);
+    } else {
+      batchColumns<LANES, false, false>(g, 0, common);
+      batchColumns<LANES, true, false>(g, common, maxColumns);
+    }
+  }
+
+  for (int l = 0; l < count; l++) results[pairs[l].index] = g.score[l];
+}
+
+/*
+Runs the groups of a list of pairs sorted by length: consecutive pairs fill
+the lanes of a group.
+*/
+template <int LANES>
+static void batchKernel(const BatchEditDistancePair* pairs, int count,
+                        const BatchEditDistanceScratch& scratch,
+                        int* results) {
+  for (int start = 0; start < count; start += LANES) {
+    int lanes = count - start < LANES ? count - start : LANES;
+    batchGroup<LANES>(pairs + start, lanes, scratch, results);
+  }
+}
+
+#endif
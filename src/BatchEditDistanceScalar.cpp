@@ -0,0 +1,9 @@
+#include "BatchEditDistance.hpp"
+#include "BatchEditDistanceKernel.hpp"
+
+// batch kernel with one pair at a time, for CPUs without SSE4.2
+void batchEditDistanceScalar(const BatchEditDistancePair* pairs, int count,
+                             const BatchEditDistanceScratch& scratch,
+                             int* results) {
+  batchKernel<1>(pairs, count, scratch, results);
+}
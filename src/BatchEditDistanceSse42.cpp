@@ -0,0 +1,9 @@
+#include "BatchEditDistance.hpp"
+#include "BatchEditDistanceKernel.hpp"
+
+// batch kernel with two pairs per vector; built with -msse4.2
+void batchEditDistanceSse42(const BatchEditDistancePair* pairs, int count,
+                            const BatchEditDistanceScratch& scratch,
+                            int* results) {
+  batchKernel<2>(pairs, count, scratch, results);
+}
@@ -0,0 +1,346 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "AffineEditDistance.hpp"
+#include "BasicEditDistance.hpp"
+#include "LocalAlignment.hpp"
+#include "Parser.hpp"
+#include "Solver.hpp"
+#include "SubmatrixCalculator.hpp"
+#include "SubmatrixRegistry.hpp"
+#include "Writer.hpp"
+
+using namespace std;
+
+// shortest time of one repetition; faster benchmarks are repeated within it
+static const double MIN_REPETITION_SECONDS = 0.02;
+
+/*
+ One measured benchmark: its name, which is the key in the CSV files, and
+ the median wall-clock time of a single run over its repetitions.
+*/
+struct Measurement {
+  string name;
+  double seconds;
+};
+
+/*
+ Runs the benchmarks and collects their measurements.
+*/
+class Bench {
+ public:
+  Bench(int repetitions) : repetitions_(repetitions) {}
+
+  /*
+   Times repetitions of body. A first run sizes the repetitions: benchmarks
+   shorter than MIN_REPETITION_SECONDS run several times per repetition, so
+   they are not lost in timer noise; longer ones count the first run as a
+   repetition.
+  */
+  void run(const string& name, const function<void()>& body) {
+    vector<double> times;
+    double first = timeRuns(body, 1);
+    int runs = 1;
+    if (first >= MIN_REPETITION_SECONDS) {
+      times.push_back(first);
+    } else {
+      runs = int(MIN_REPETITION_SECONDS / max(first, 1e-7)) + 1;
+    }
+    while ((int)times.size() < repetitions_) {
+      times.push_back(timeRuns(body, runs) / runs);
+    }
+
+    sort(times.begin(), times.end());
+    Measurement m = {name, times[times.size() / 2]};
+    measurements_.push_back(m);
+    printf("%-36s %12.4g s\n", name.c_str(), m.seconds);
+    fflush(stdout);
+  }
+
+  const vector<Measurement>& getMeasurements() const { return measurements_; }
+
+ private:
+  int repetitions_;
+  vector<Measurement> measurements_;
+
+  static double timeRuns(const function<void()>& body, int runs) {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int r = 0; r < runs; r++) body();
+    return chrono::duration<double>(chrono::steady_clock::now() - start)
+        .count();
+  }
+};
+
+// the first two sequences of a FASTA file, or false if it has fewer
+static bool readPair(const string& path, string& a, string& b) {
+  Parser parser(path.c_str());
+  vector<Sequence*> sequences = parser.readSequences();
+  bool found = sequences.size() >= 2;
+  if (found) {
+    a = sequences[0]->getData();
+    b = sequences[1]->getData();
+  }
+  for (unsigned int i = 0; i < sequences.size(); i++) delete sequences[i];
+  return found;
+}
+
+/*
+ A random sequence of the given length and a copy of it in which every
+ position is substituted, deleted or followed by an insert with probability
+ divergence. The generator is seeded, so every run measures the same pair.
+*/
+static void syntheticPair(int length, double divergence, string& a,
+                          string& b) {
+  mt19937 random(length);
+  const char* bases = "ACGT";
+  a.resize(length);
+  for (int i = 0; i < length; i++) a[i] = bases[random() % 4];
+
+  b.clear();
+  uint32_t threshold = uint32_t(divergence * 4294967295.0);
+  for (int i = 0; i < length; i++) {
+    if (random() > threshold) {
+      b += a[i];
+      continue;
+    }
+    int event = random() % 3;
+    if (event == 0) {
+      // one of the three other bases
+      int base = strchr(bases, a[i]) - bases;
+      b += bases[(base + 1 + random() % 3) % 4];
+    } else if (event == 2) {
+      b += a[i];
+      b += bases[random() % 4];
+    }
+  }
+}
+
+// the measurements of a CSV file written by writeCsv(), by name
+static map<string, double> readCsv(const string& path) {
+  map<string, double> values;
+  ifstream in(path.c_str());
+  string line;
+  getline(in, line);  // header
+  while (getline(in, line)) {
+    size_t comma = line.find(',');
+    if (comma == string::npos) continue;
+    values[line.substr(0, comma)] = atof(line.c_str() + comma + 1);
+  }
+  return values;
+}
+
+static void writeCsv(const string& path, const vector<Measurement>& results) {
+  ofstream out(path.c_str());
+  out << "benchmark,seconds\n";
+  for (unsigned int i = 0; i < results.size(); i++) {
+    out << results[i].name << "," << results[i].seconds << "\n";
+  }
+}
+
+/*
+ Compares the results with a baseline; a benchmark regresses when it takes
+ more than tolerance (a fraction) longer than its baseline. Returns the
+ number of regressions.
+*/
+static int compare(const vector<Measurement>& results,
+                   const map<string, double>& baseline, double tolerance) {
+  int regressions = 0;
+  printf("\n%-36s %12s %12s %8s\n", "benchmark", "baseline", "current",
+         "change");
+  for (unsigned int i = 0; i < results.size(); i++) {
+    map<string, double>::const_iterator it = baseline.find(results[i].name);
+    if (it == baseline.end()) {
+      printf("%-36s %12s %12.4g\n", results[i].name.c_str(), "-",
+             results[i].seconds);
+      continue;
+    }
+    double change = (results[i].seconds - it->second) / it->second;
+    bool regressed = change > tolerance;
+    regressions += regressed;
+    printf("%-36s %12.4g %12.4g %+7.1f%%%s\n", results[i].name.c_str(),
+           it->second, results[i].seconds, 100 * change,
+           regressed ? "  REGRESSION" : "");
+  }
+  return regressions;
+}
+
+static void usage(const char* program) {
+  cout << "Usage: " << program
+       << " [-r repetitions] [-d data_dir] [-o results.csv]"
+          " [-b baseline.csv] [-x tolerance] [-l]"
+       << endl;
+}
+
+/* Benchmark program
+ Usage: [-r repetitions] [-d data_dir] [-o results.csv] [-b baseline.csv]
+        [-x tolerance] [-l]
+ Options:
+   -r repetitions  runs of every benchmark; the median is reported (default: 3)
+   -d data_dir     directory of the test-<length>.fa files (default: test/data)
+   -o results.csv  file the results are written to
+   -b baseline.csv results to compare with; the exit status is 1 when a
+                   benchmark is slower than its baseline by more than the
+                   tolerance
+   -x tolerance    allowed slowdown as a fraction (default: 0.25)
+   -l              also run the test-50000 pair, which takes a minute
+ Benchmarks run on one thread so results compare across machines with a
+ different number of cores.
+*/
+int main(int argc, char** argv) {
+  int repetitions = 3;
+  string dataDirectory = "test/data";
+  string output;
+  string baseline;
+  double tolerance = 0.25;
+  bool large = false;
+  int option;
+  while ((option = getopt(argc, argv, "r:d:o:b:x:l")) != -1) {
+    if (option == 'r') {
+      repetitions = max(1, atoi(optarg));
+    } else if (option == 'd') {
+      dataDirectory = optarg;
+    } else if (option == 'o') {
+      output = optarg;
+    } else if (option == 'b') {
+      baseline = optarg;
+    } else if (option == 'x') {
+      tolerance = atof(optarg);
+    } else if (option == 'l') {
+      large = true;
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  SubmatrixRegistry::setThreads(1);
+  Bench bench(repetitions);
+
+  // generation of every table small enough to calculate up front
+  for (int dimension = 1; dimension <= SUBMATRIX_MAX_DIMENSION; dimension++) {
+    if (!SubmatrixCalculator(dimension).tableFits()) break;
+    ostringstream name;
+    name << "table/dim" << dimension;
+    bench.run(name.str(), [dimension]() {
+      SubmatrixCalculator table(dimension);
+      table.calculate(1);
+    });
+  }
+
+  // the algorithms over the test files; tables come from the registry and
+  // are calculated before the first measurement
+  vector<int> lengths = {100, 1000, 5000, 10000};
+  if (large) lengths.push_back(50000);
+  vector<pair<string, pair<string, string>>> pairs;
+  for (unsigned int i = 0; i < lengths.size(); i++) {
+    ostringstream path, name;
+    path << dataDirectory << "/test-" << lengths[i] << ".fa";
+    name << "test-" << lengths[i];
+    string a, b;
+    if (!readPair(path.str(), a, b)) {
+      cout << "Could not read a pair from " << path.str() << endl;
+      return 1;
+    }
+    pairs.push_back(make_pair(name.str(), make_pair(a, b)));
+  }
+  double divergences[] = {0.01, 0.1, 0.3};
+  for (int d = 0; d < 3; d++) {
+    ostringstream name;
+    name << "synthetic-20000-d" << int(100 * divergences[d]);
+    string a, b;
+    syntheticPair(20000, divergences[d], a, b);
+    pairs.push_back(make_pair(name.str(), make_pair(a, b)));
+  }
+
+  for (unsigned int i = 0; i < pairs.size(); i++) {
+    const string& name = pairs[i].first;
+    const string& a = pairs[i].second.first;
+    const string& b = pairs[i].second.second;
+    int dimension = Solver::chooseDimension(max(a.size(), b.size()), "ATGC");
+    const SubmatrixCalculator* table = SubmatrixRegistry::get(dimension);
+
+    bench.run("distance/" + name, [&]() {
+      Solver solver(a, b, table);
+      solver.setThreads(1);
+      solver.calculate();
+    });
+    bench.run("banded/" + name, [&]() {
+      Solver solver(a, b, table);
+      solver.setThreads(1);
+      solver.calculate_banded();
+    });
+    // the full matrix of the largest inputs takes gigabytes
+    if (a.size() * b.size() <= 1e9) {
+      bench.run("path/" + name, [&]() {
+        Solver solver(a, b, table);
+        solver.setThreads(1);
+        solver.calculate_with_path();
+      });
+    }
+    bench.run("basic/" + name, [&]() {
+      BasicEditDistance<> basic(a, b);
+      basic.calculate();
+    });
+    bench.run("affine/" + name, [&]() {
+      AffineEditDistance affine(a, b);
+      affine.calculate();
+    });
+    bench.run("affine-path/" + name, [&]() {
+      AffineEditDistance affine(a, b);
+      affine.calculate_with_path();
+    });
+    bench.run("local/" + name, [&]() {
+      LocalAlignment local(a, b);
+      local.calculate();
+    });
+  }
+
+  // parsing and writing the largest test file
+  string largest = dataDirectory + "/test-1000000.fa";
+  bench.run("parse/" + largest.substr(largest.rfind('/') + 1), [&]() {
+    Parser parser(largest.c_str());
+    vector<Sequence*> sequences = parser.readSequences();
+    for (unsigned int i = 0; i < sequences.size(); i++) delete sequences[i];
+  });
+  Parser parser(largest.c_str());
+  vector<Sequence*> sequences = parser.readSequences();
+  if (sequences.size() >= 2) {
+    bench.run("write/" + largest.substr(largest.rfind('/') + 1), [&]() {
+      Writer writer("/dev/null");
+      for (int k = 0; k < 16; k++) {
+        Result result(sequences[0], sequences[1], k);
+        writer.writeResult(&result);
+      }
+    });
+  }
+  for (unsigned int i = 0; i < sequences.size(); i++) delete sequences[i];
+
+  if (!output.empty()) writeCsv(output, bench.getMeasurements());
+  if (!baseline.empty()) {
+    map<string, double> reference = readCsv(baseline);
+    if (reference.empty()) {
+      cout << "Could not read baseline " << baseline << endl;
+      return 1;
+    }
+    int regressions = compare(bench.getMeasurements(), reference, tolerance);
+    if (regressions > 0) {
+      cout << regressions << " benchmark(s) regressed by more than "
+           << 100 * tolerance << "%" << endl;
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,8 @@
+#include "BitParallelEditDistance.hpp"
+#include "BitParallelKernel.hpp"
+
+// bit-parallel kernel for AVX2, four words per vector; built with -mavx2
+int bitParallelAvx2(const uint64_t* peq, int words, int rows,
+                    const uint8_t* text, int columns, uint8_t* carries) {
+  return bitParallelKernel<4>(peq, words, rows, text, columns, carries);
+}
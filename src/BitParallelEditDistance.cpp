@@ -0,0 +1,83 @@
+#include "BitParallelEditDistance.hpp"
+
+BitParallelEditDistance::Kernel BitParallelEditDistance::forcedKernel_ =
+    BitParallelEditDistance::KERNEL_AUTO;
+
+// constructor; the distance is symmetric, so the shorter string goes into
+// the bit-vectors
+BitParallelEditDistance::BitParallelEditDistance(const string& first,
+                                                 const string& second) {
+  if (first.size() <= second.size()) {
+    pattern_ = first;
+    text_ = second;
+  } else {
+    pattern_ = second;
+    text_ = first;
+  }
+}
+
+int BitParallelEditDistance::calculate() {
+  int rows = pattern_.size();
+  int columns = text_.size();
+  int words = (rows + 63) / 64;
+
+  // symbols of the pattern get codes 0..k-1; text characters missing from
+  // the pattern share code k, whose match masks are empty
+  uint8_t codes[256];
+  int symbols = 0;
+  int seen[256];
+  for (int c = 0; c < 256; c++) seen[c] = -1;
+  for (int i = 0; i < rows; i++) {
+    unsigned char c = pattern_[i];
+    if (seen[c] < 0) seen[c] = symbols++;
+  }
+  for (int c = 0; c < 256; c++) codes[c] = seen[c] < 0 ? symbols : seen[c];
+
+  vector<uint64_t> peq((symbols + 1) * words, 0);
+  for (int i = 0; i < rows; i++) {
+    peq[codes[(unsigned char)pattern_[i]] * words + i / 64] |= 1ULL << (i % 64);
+  }
+
+  vector<uint8_t> text(columns);
+  for (int j = 0; j < columns; j++) text[j] = codes[(unsigned char)text_[j]];
+  vector<uint8_t> carries(2 * columns);
+
+  switch (getKernel()) {
+    case KERNEL_AVX2:
+      return bitParallelAvx2(peq.data(), words, rows, text.data(), columns,
+                             carries.data());
+    case KERNEL_SSE42:
+      return bitParallelSse42(peq.data(), words, rows, text.data(), columns,
+                              carries.data());
+    default:
+      return bitParallelScalar(peq.data(), words, rows, text.data(), columns,
+                               carries.data());
+  }
+}
+
+void BitParallelEditDistance::setKernel(Kernel kernel) {
+  forcedKernel_ = kernel;
+}
+
+BitParallelEditDistance::Kernel BitParallelEditDistance::getKernel() {
+  static const bool avx2 = __builtin_cpu_supports("avx2");
+  static const bool sse42 = __builtin_cpu_supports("sse4.2");
+
+  if (forcedKernel_ == KERNEL_SCALAR) return KERNEL_SCALAR;
+  if (forcedKernel_ == KERNEL_SSE42 && sse42) return KERNEL_SSE42;
+  if (forcedKernel_ == KERNEL_AVX2 && avx2) return KERNEL_AVX2;
+  return avx2 ? KERNEL_AVX2 : sse42 ? KERNEL_SSE42 : KERNEL_SCALAR;
+}
+
+const char* BitParallelEditDistance::getKernelName(Kernel kernel) {
+  switch (kernel) {
+    case KERNEL_AVX2:
+      return "AVX2";
+    case KERNEL_SSE42:
+      return "SSE4.2";
+    case KERNEL_SCALAR:
+      return "scalar";
+    default:
+      return "auto";
+  }
+}
@@ -0,0 +1,55 @@
+#ifndef BITPARALLELEDITDISTANCE_HPP
+#define BITPARALLELEDITDISTANCE_HPP
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/*
+Unit-cost edit distance with Myers' bit-vector algorithm, 64 cells of a
+column per word operation. Works for strings of any length (blocked over
+64-row words) and any characters, compared exactly like BasicEditDistance.
+The kernel is picked at runtime from the instruction sets the CPU supports.
+*/
+class BitParallelEditDistance {
+ public:
+  enum Kernel { KERNEL_AUTO, KERNEL_SCALAR, KERNEL_SSE42, KERNEL_AVX2 };
+
+  BitParallelEditDistance(const string& first, const string& second);
+
+  int calculate();
+
+  // forces a kernel, e.g. for benchmarks; KERNEL_AUTO picks the widest one
+  // the CPU supports. Unsupported kernels fall back to automatic selection.
+  static void setKernel(Kernel kernel);
+  // the kernel calculate() runs on this CPU
+  static Kernel getKernel();
+  static const char* getKernelName(Kernel kernel);
+
+ private:
+  // the shorter string is the bit-vector pattern, the longer the text
+  string pattern_;
+  string text_;
+
+  static Kernel forcedKernel_;
+};
+
+/*
+Kernels of BitParallelEditDistance, see BitParallelKernel.hpp. All take the
+match masks of the pattern (peq[symbol * words + word], bit i of a word set
+when row i of that word holds the symbol), the number of rows of the pattern
+and the text as symbol codes, and return the edit distance. carries is
+2 * columns bytes of scratch memory, allocated by the caller so the kernel
+units instantiate no library templates for their instruction sets.
+*/
+int bitParallelScalar(const uint64_t* peq, int words, int rows,
+                      const uint8_t* text, int columns, uint8_t* carries);
+int bitParallelSse42(const uint64_t* peq, int words, int rows,
+                     const uint8_t* text, int columns, uint8_t* carries);
+int bitParallelAvx2(const uint64_t* peq, int words, int rows,
+                    const uint8_t* text, int columns, uint8_t* carries);
+
+#endif
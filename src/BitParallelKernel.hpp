@@ -0,0 +1,211 @@
+#ifndef BITPARALLELKERNEL_HPP
+#define BITPARALLELKERNEL_HPP
+
+#include <stdint.h>
+
+// vector of LANES 64-bit words
+template <int LANES>
+struct BitParallelLanes;
+template <>
+struct BitParallelLanes<1> {
+  typedef uint64_t type __attribute__((vector_size(8)));
+};
+template <>
+struct BitParallelLanes<2> {
+  typedef uint64_t type __attribute__((vector_size(16)));
+};
+template <>
+struct BitParallelLanes<4> {
+  typedef uint64_t type __attribute__((vector_size(32)));
+};
+
+/*
+State of one group of LANES words of the pattern; see bitParallelKernel().
+*/
+template <int LANES>
+struct BitParallelGroup {
+  typedef typename BitParallelLanes<LANES>::type Lanes;
+
+  // vertical deltas of every word (+1 / -1 bits) and the horizontal deltas
+  // entering the top of each word at the current step
+  Lanes pv, mv, hp, hm;
+  const uint64_t* peq[LANES];
+  int words;
+  const uint8_t* text;
+  int columns;
+  // horizontal deltas leaving the group above (in) and this group (out)
+  uint8_t* carryPlus;
+  uint8_t* carryMinus;
+  // lane of the last word of the pattern, its last row bit and the score
+  int scoreLane;
+  int lastBit;
+  int score;
+};
+
+/*
+One step of a group: lane l processes column step - l. EDGE steps are the
+first and last LANES - 1 ones (and all steps of a group with lanes past the
+last word), where some lanes lie outside the text and keep their state.
+SCORE is set for the group holding the last word of the pattern.
+*/
+template <int LANES, bool EDGE, bool SCORE>
+static inline __attribute__((always_inline)) void bitParallelStep(
+    BitParallelGroup<LANES>& g, int step) {
+  typedef typename BitParallelLanes<LANES>::type Lanes;
+
+  Lanes eq, active;
+  for (int l = 0; l < LANES; l++) {
+    int column = step - l;
+    if (EDGE) {
+      bool valid = column >= 0 && column < g.columns && g.peq[l] != NULL;
+      eq[l] = valid ? g.peq[l][g.text[column] * g.words] : 0;
+      active[l] = valid ? ~0ULL : 0;
+    } else {
+      eq[l] = g.peq[l][g.text[column] * g.words];
+    }
+  }
+  // lane 0 takes the carry of the group above; the others already hold the
+  // carry of the lane above from the previous step
+  if (!EDGE || step < g.columns) {
+    g.hp[0] = g.carryPlus[step];
+    g.hm[0] = g.carryMinus[step];
+  }
+
+  Lanes xv = eq | g.mv;
+  eq |= g.hm;
+  Lanes xh = (((eq & g.pv) + g.pv) ^ g.pv) | eq;
+  Lanes ph = g.mv | ~(xh | g.pv);
+  Lanes mh = g.pv & xh;
+
+  if (SCORE) {
+    int column = step - g.scoreLane;
+    if (!EDGE || (column >= 0 && column < g.columns)) {
+      g.score += (int)((ph[g.scoreLane] >> g.lastBit) & 1) -
+                 (int)((mh[g.scoreLane] >> g.lastBit) & 1);
+    }
+  }
+
+  Lanes outPlus = ph >> 63;
+  Lanes outMinus = mh >> 63;
+  ph = (ph << 1) | g.hp;
+  mh = (mh << 1) | g.hm;
+  Lanes pv = mh | ~(xv | ph);
+  Lanes mv = ph & xv;
+  if (EDGE) {
+    // lanes outside the text keep their state for the columns to come
+    g.pv = (pv & active) | (g.pv & ~active);
+    g.mv = (mv & active) | (g.mv & ~active);
+  } else {
+    g.pv = pv;
+    g.mv = mv;
+  }
+
+  int lastColumn = step - (LANES - 1);
+  if (!EDGE || (lastColumn >= 0 && lastColumn < g.columns)) {
+    g.carryPlus[lastColumn] = outPlus[LANES - 1];
+    g.carryMinus[lastColumn] = outMinus[LANES - 1];
+  }
+  if (LANES > 1) {
+    // every lane hands its carry to the lane below; lane 0 gets the carry of
+    // the group above at the next step
+    Lanes order;
+    for (int l = 0; l < LANES; l++) order[l] = (l + LANES - 1) % LANES;
+    g.hp = __builtin_shuffle(outPlus, order);
+    g.hm = __builtin_shuffle(outMinus, order);
+  }
+}
+
+/*
+All steps of a group; see bitParallelStep(). Works on a local copy of the
+group state, which the compiler can keep in registers even though the
+carry stores may alias anything.
+*/
+template <int LANES, bool SCORE>
+static void bitParallelSteps(BitParallelGroup<LANES>& group, bool partial) {
+  BitParallelGroup<LANES> g = group;
+  int steps = g.columns + LANES - 1;
+  if (partial) {
+    for (int step = 0; step < steps; step++) {
+      bitParallelStep<LANES, true, SCORE>(g, step);
+    }
+    group = g;
+    return;
+  }
+
+  int body = LANES - 1 < steps ? LANES - 1 : steps;
+  int tail = body > g.columns ? body : g.columns;
+  for (int step = 0; step < body; step++) {
+    bitParallelStep<LANES, true, SCORE>(g, step);
+  }
+  for (int step = body; step < tail; step++) {
+    bitParallelStep<LANES, false, SCORE>(g, step);
+  }
+  for (int step = tail; step < steps; step++) {
+    bitParallelStep<LANES, true, SCORE>(g, step);
+  }
+  group = g;
+}
+
+/*
+Myers' bit-vector algorithm in Hyyro's blocked form: the pattern is split in
+64-row words, every word keeps the vertical deltas of its rows for the
+current column as the Pv/Mv bit-vectors, and the horizontal delta at its
+bottom row is carried into the word below.
+Within a column that carry is a sequential dependency, so LANES consecutive
+words run staggered in the lanes of one vector: at step s lane l processes
+column s - l, taking its carry from the step lane l - 1 finished just
+before. The last lane hands its carries to the next group of words through
+a per-column array.
+The caller passes 2 * columns bytes of carries memory.
+Only the kernel translation units include this header, and the templates are
+internal to each of them, so every copy is compiled for the instruction set
+of its unit only.
+*/
+template <int LANES>
+static int bitParallelKernel(const uint64_t* peq, int words, int rows,
+                             const uint8_t* text, int columns,
+                             uint8_t* carries) {
+  if (rows == 0) return columns;
+  if (columns == 0) return rows;
+
+  // the first word starts from D[0][j] = j, a +1 delta in every column
+  uint8_t* carryPlus = carries;
+  uint8_t* carryMinus = carries + columns;
+  for (int j = 0; j < columns; j++) {
+    carryPlus[j] = 1;
+    carryMinus[j] = 0;
+  }
+
+  BitParallelGroup<LANES> g;
+  g.words = words;
+  g.text = text;
+  g.columns = columns;
+  g.carryPlus = carryPlus;
+  g.carryMinus = carryMinus;
+  g.lastBit = (rows - 1) % 64;
+  g.score = rows;
+
+  typename BitParallelLanes<LANES>::type zero = {0};
+  for (int group = 0; group < words; group += LANES) {
+    g.mv = zero;
+    g.pv = ~zero;
+    g.hp = zero;
+    g.hm = zero;
+    for (int l = 0; l < LANES; l++) {
+      // lanes past the last word match nothing and are never read
+      g.peq[l] = group + l < words ? peq + group + l : NULL;
+    }
+    g.scoreLane = words - 1 - group;
+
+    bool partial = group + LANES > words;
+    if (g.scoreLane < LANES) {
+      bitParallelSteps<LANES, true>(g, partial);
+    } else {
+      bitParallelSteps<LANES, false>(g, partial);
+    }
+  }
+
+  return g.score;
+}
+
+#endif
@@ -0,0 +1,8 @@
+#include "BitParallelEditDistance.hpp"
+#include "BitParallelKernel.hpp"
+
+// portable bit-parallel kernel, one word at a time
+int bitParallelScalar(const uint64_t* peq, int words, int rows,
+                      const uint8_t* text, int columns, uint8_t* carries) {
+  return bitParallelKernel<1>(peq, words, rows, text, columns, carries);
+}
@@ -0,0 +1,8 @@
+#include "BitParallelEditDistance.hpp"
+#include "BitParallelKernel.hpp"
+
+// bit-parallel kernel for SSE4.2, two words per vector; built with -msse4.2
+int bitParallelSse42(const uint64_t* peq, int words, int rows,
+                     const uint8_t* text, int columns, uint8_t* carries) {
+  return bitParallelKernel<2>(peq, words, rows, text, columns, carries);
+}
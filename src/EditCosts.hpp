@@ -0,0 +1,105 @@
+#ifndef EDITCOSTS_HPP
+#define EDITCOSTS_HPP
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/*
+Costs of the edit operations: deleting a character of the first string,
+inserting a character of the second one, and replacing one symbol by another.
+Replacements cost replaceCost unless a substitution matrix is given; its rows
+are symbols of the first string and its columns symbols of the second, both
+indexed by their position in the alphabet. Matching symbols cost 0 without a
+matrix. All costs are small non-negative integers; the Four Russians tables
+widen their step range with the indel costs (see SubmatrixCalculator).
+*/
+struct EditCosts {
+  int replaceCost;
+  int deleteCost;
+  int insertCost;
+  // |alphabet| x |alphabet| replacement costs, or empty
+  vector<int> replaceCosts;
+
+  explicit EditCosts(int replace = 1, int remove = 1, int insert = 1)
+      : replaceCost(replace), deleteCost(remove), insertCost(insert) {}
+
+  /*
+      Transition/transversion weighted costs for a DNA alphabet: purine to
+      purine (A <-> G) and pyrimidine to pyrimidine (C <-> T) replacements
+      cost transition, all others transversion. Symbols other than ACGT are
+      replaced at the transversion cost.
+  */
+  static EditCosts nucleotide(const string& alphabet, int transition,
+                              int transversion, int remove, int insert) {
+    EditCosts costs(transversion, remove, insert);
+    int size = alphabet.size();
+    costs.replaceCosts.assign(size * size, transversion);
+    for (int i = 0; i < size; i++) {
+      for (int j = 0; j < size; j++) {
+        char x = alphabet[i], y = alphabet[j];
+        if (i == j) {
+          costs.replaceCosts[i * size + j] = 0;
+        } else if ((x == 'A' && y == 'G') || (x == 'G' && y == 'A') ||
+                   (x == 'C' && y == 'T') || (x == 'T' && y == 'C')) {
+          costs.replaceCosts[i * size + j] = transition;
+        }
+      }
+    }
+    return costs;
+  }
+
+  // cost of replacing symbol x of the first string by symbol y of the second
+  int replace(int x, int y, int alphabetSize) const {
+    if (!replaceCosts.empty()) return replaceCosts[x * alphabetSize + y];
+    return x == y ? 0 : replaceCost;
+  }
+
+  // whether these are the classic Levenshtein costs
+  bool isUnit() const {
+    if (deleteCost != 1 || insertCost != 1) return false;
+    if (replaceCosts.empty()) return replaceCost == 1;
+    int size = 0;
+    while (size * size < (int)replaceCosts.size()) size++;
+    for (int i = 0; i < size; i++) {
+      for (int j = 0; j < size; j++) {
+        if (replace(i, j, size) != (i != j)) return false;
+      }
+    }
+    return true;
+  }
+
+  // whether swapping the two strings keeps every distance
+  bool isSymmetric() const {
+    if (deleteCost != insertCost) return false;
+    int size = 0;
+    while (size * size < (int)replaceCosts.size()) size++;
+    for (int i = 0; i < size; i++) {
+      for (int j = 0; j < i; j++) {
+        if (replaceCosts[i * size + j] != replaceCosts[j * size + i]) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  // whether every cost is non-negative, as the step encoding requires
+  bool isValid() const {
+    if (replaceCost < 0 || deleteCost < 0 || insertCost < 0) return false;
+    for (unsigned int i = 0; i < replaceCosts.size(); i++) {
+      if (replaceCosts[i] < 0) return false;
+    }
+    return true;
+  }
+
+  bool operator<(const EditCosts& other) const {
+    if (replaceCost != other.replaceCost) return replaceCost < other.replaceCost;
+    if (deleteCost != other.deleteCost) return deleteCost < other.deleteCost;
+    if (insertCost != other.insertCost) return insertCost < other.insertCost;
+    return replaceCosts < other.replaceCosts;
+  }
+};
+
+#endif
@@ -0,0 +1,216 @@
+#include "LocalAlignment.hpp"
+
+#include <algorithm>
+
+#include "AffineEditDistance.hpp"
+#include "BasicEditDistance.hpp"
+#include "Metrics.hpp"
+#include "StripedScratch.hpp"
+
+// scores of the 16-bit kernels saturate at 0xFFFF
+#define LOCAL_NARROW_LIMIT 0xFFFFLL
+#define LOCAL_WIDE_LIMIT (0x3FFFFFFF / 2)
+
+/*
+  The reference recurrence, column by column like the striped kernels so
+  ties are broken the same way.
+*/
+LocalAlignmentEnd localAlignmentScalar(const LocalAlignmentProblem& problem) {
+  int n = problem.rows;
+  int m = problem.columns;
+  int extend = problem.gapExtend;
+  int first = problem.gapOpen + extend;
+  LocalAlignmentEnd best = {0, 0, 0};
+
+  vector<int> h(n + 1, 0), e(n + 1, 0);
+  for (int j = 1; j <= m; j++) {
+    const int32_t* scores = problem.score + problem.second[j - 1];
+    int diagonal = 0;
+    int f = 0;
+    for (int i = 1; i <= n; i++) {
+      e[i] = max(0, max(e[i] - extend, h[i] - first));
+      f = max(0, max(f - extend, h[i - 1] - first));
+      int current = diagonal + scores[problem.first[i - 1] * problem.symbols];
+      current = max(max(current, 0), max(e[i], f));
+      diagonal = h[i];
+      h[i] = current;
+      if (current > best.score) {
+        best.score = current;
+        best.row = i;
+        best.column = j;
+      }
+    }
+  }
+  return best;
+}
+
+LocalAlignment::LocalAlignment(const string& first, const string& second,
+                               int match, int mismatch, int gapOpen,
+                               int gapExtend)
+    : match_(match),
+      mismatch_(mismatch),
+      gapOpen_(gapOpen),
+      gapExtend_(gapExtend),
+      threads_(1),
+      symbols_(0),
+      global_("", "") {
+  setStrings(first, second);
+}
+
+void LocalAlignment::setStrings(const string& first, const string& second) {
+  first_ = first;
+  second_ = second;
+}
+
+void LocalAlignment::setScores(int match, int mismatch) {
+  match_ = match;
+  mismatch_ = mismatch;
+}
+
+void LocalAlignment::setGapCosts(int gapOpen, int gapExtend) {
+  gapOpen_ = gapOpen;
+  gapExtend_ = gapExtend;
+}
+
+void LocalAlignment::setThreads(int threads) { threads_ = threads; }
+
+// gives every byte used by either string a dense code, like
+// AffineEditDistance::encode()
+void LocalAlignment::encode() {
+  int codes[256];
+  for (int c = 0; c < 256; c++) codes[c] = -1;
+  symbols_ = 0;
+
+  firstCodes_.resize(first_.size());
+  for (unsigned int i = 0; i < first_.size(); i++) {
+    unsigned char c = first_[i];
+    if (codes[c] < 0) codes[c] = symbols_++;
+    firstCodes_[i] = codes[c];
+  }
+  secondCodes_.resize(second_.size());
+  for (unsigned int j = 0; j < second_.size(); j++) {
+    unsigned char c = second_[j];
+    if (codes[c] < 0) codes[c] = symbols_++;
+    secondCodes_[j] = codes[c];
+  }
+
+  table_.resize(symbols_ * symbols_);
+  for (int a = 0; a < symbols_; a++) {
+    for (int b = 0; b < symbols_; b++) table_[a * symbols_ + b] = score(a, b);
+  }
+}
+
+/*
+  Runs the widest kernel the CPU supports whose scores cannot overflow: no
+  score exceeds the best one of every character of the shorter string, and
+  the kernels add one more biased score before taking maxima.
+*/
+static LocalAlignmentEnd runLocalKernel(const LocalAlignmentProblem& problem,
+                                        vector<uint8_t>& scratch) {
+  long long best = 0, worst = 0;
+  for (int i = 0; i < problem.symbols * problem.symbols; i++) {
+    best = max(best, (long long)problem.score[i]);
+    worst = min(worst, (long long)problem.score[i]);
+  }
+  long long bound = best * (min(problem.rows, problem.columns) + 1) - worst;
+
+  BasicEditDistanceKernels::Kernel kernel = BasicEditDistanceKernels::getKernel();
+  if (kernel == BasicEditDistanceKernels::KERNEL_SCALAR ||
+      bound >= LOCAL_WIDE_LIMIT) {
+    return localAlignmentScalar(problem);
+  }
+  bool wide = bound >= LOCAL_NARROW_LIMIT;
+  size_t size = stripedScratchSize(problem.rows, problem.second,
+                                   problem.columns, 2);
+  if (scratch.size() < size) scratch.resize(size);
+  if (kernel == BasicEditDistanceKernels::KERNEL_AVX2) {
+    return localAlignmentAvx2(problem, wide, scratch.data());
+  }
+  return localAlignmentSse42(problem, wide, scratch.data());
+}
+
+LocalAlignment::Hit LocalAlignment::calculate() {
+  PhaseTimer timer(Metrics::FILL);
+  encode();
+  LocalAlignmentProblem problem = {
+      firstCodes_.data(), (int)firstCodes_.size(), secondCodes_.data(),
+      (int)secondCodes_.size(), table_.data(), symbols_, gapOpen_,
+      gapExtend_};
+  LocalAlignmentEnd end = runLocalKernel(problem, kernelScratch_);
+  Hit hit = {end.score, 0, end.row, 0, end.column};
+  return hit;
+}
+
+/*
+  Finds where the alignment ending at the end of hit starts, by aligning the
+  reversed prefixes up to that end. Their first characters get codes of
+  their own that score one more when aligned with each other, so only
+  alignments through that cell, which are those ending at the end of hit,
+  reach the score plus one; any other scores at most the score. The
+  optimal alignment always ends with a match, since the kernel reports the
+  first cell reaching the best score.
+*/
+LocalAlignment::Hit LocalAlignment::findStart(const Hit& end) {
+  int n = end.firstEnd;
+  int m = end.secondEnd;
+  int symbols = symbols_ + 2;
+  uint8_t firstAnchor = symbols_, secondAnchor = symbols_ + 1;
+
+  vector<uint8_t>& a = reversedFirst_;
+  vector<uint8_t>& b = reversedSecond_;
+  a.assign(firstCodes_.rend() - n, firstCodes_.rend());
+  b.assign(secondCodes_.rend() - m, secondCodes_.rend());
+  uint8_t x = a[0], y = b[0];
+  a[0] = firstAnchor;
+  b[0] = secondAnchor;
+
+  // the anchors score like the characters they replace
+  vector<int32_t>& table = anchorTable_;
+  table.resize(symbols * symbols);
+  for (int i = 0; i < symbols; i++) {
+    for (int j = 0; j < symbols; j++) {
+      int p = i == firstAnchor ? x : i == secondAnchor ? y : i;
+      int q = j == firstAnchor ? x : j == secondAnchor ? y : j;
+      table[i * symbols + j] = score(p, q);
+    }
+  }
+  table[firstAnchor * symbols + secondAnchor] += 1;
+
+  LocalAlignmentProblem problem = {a.data(), n, b.data(), m, table.data(),
+                                   symbols, gapOpen_, gapExtend_};
+  LocalAlignmentEnd start = runLocalKernel(problem, kernelScratch_);
+  Hit hit = end;
+  hit.firstStart = n - start.row;
+  hit.secondStart = m - start.column;
+  return hit;
+}
+
+/*
+  Aligns the substrings between the start and the end of the best hit. Their
+  best global alignment scores the hit's score, and maximizing the score
+  is minimizing an affine edit distance: every alignment of n and m
+  characters has (n + m - gaps) / 2 replacements, so twice the score is
+  match * (n + m) minus the cost with replacements of 2 * (match - score),
+  gaps opening at 2 * gapOpen and extending at 2 * gapExtend + match.
+*/
+pair<LocalAlignment::Hit, pair<string, string> >
+LocalAlignment::calculate_with_path() {
+  Hit hit = calculate();
+  if (hit.score == 0) {
+    hit.firstEnd = hit.secondEnd = 0;
+    return make_pair(hit, make_pair(string(), string()));
+  }
+  {
+    PhaseTimer timer(Metrics::TRACEBACK);
+    hit = findStart(hit);
+  }
+
+  global_.setStrings(
+      first_.substr(hit.firstStart, hit.firstEnd - hit.firstStart),
+      second_.substr(hit.secondStart, hit.secondEnd - hit.secondStart));
+  global_.setGapCosts(2 * gapOpen_, 2 * gapExtend_ + match_);
+  global_.setMismatch(2 * (match_ + mismatch_));
+  global_.setThreads(threads_);
+  pair<int, pair<string, string> > path = global_.calculate_with_path();
+  return make_pair(hit, path.second);
+}
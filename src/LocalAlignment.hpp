@@ -0,0 +1,114 @@
+#ifndef LOCALALIGNMENT_HPP
+#define LOCALALIGNMENT_HPP
+
+#include <stdint.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "AffineEditDistance.hpp"
+
+using namespace std;
+
+/*
+Local alignment (Smith-Waterman with affine gaps): finds the pair of
+substrings whose alignment scores highest, where matches score match,
+mismatches lose mismatch and a gap of k characters loses gapOpen +
+k * gapExtend. Scores never drop below 0, so an alignment starts wherever
+its prefix would score nothing.
+calculate() only finds the best score and where it ends, on a striped SIMD
+kernel (see LocalAlignmentKernel.hpp) picked like the ones of
+BasicEditDistance, in memory linear in the string lengths.
+calculate_with_path() then finds where that alignment starts with a second
+pass over the reversed prefixes, and aligns only the substrings between
+start and end, globally and in linear memory (see AffineEditDistance).
+*/
+class LocalAlignment {
+ public:
+  /*
+      The best local alignment: its score and the substrings it covers,
+      [firstStart, firstEnd) of the first string and [secondStart,
+      secondEnd) of the second. Where no characters match the score is 0
+      and both substrings are empty.
+  */
+  struct Hit {
+    int score;
+    int firstStart, firstEnd;
+    int secondStart, secondEnd;
+  };
+
+  LocalAlignment(const string& first, const string& second, int match = 2,
+                 int mismatch = 3, int gapOpen = 3, int gapExtend = 1);
+
+  // replaces the strings, keeping the scores
+  void setStrings(const string& first, const string& second);
+  // the reward of a match and the penalty of a mismatch, both positive
+  void setScores(int match, int mismatch);
+  void setGapCosts(int gapOpen, int gapExtend);
+  // number of threads of the traceback; 0 uses every core
+  void setThreads(int threads);
+
+  // the best score and where it ends; the starts are left 0
+  Hit calculate();
+  // the best alignment and the covered substrings aligned
+  pair<Hit, pair<string, string> > calculate_with_path();
+
+ private:
+  string first_, second_;
+  int match_, mismatch_, gapOpen_, gapExtend_;
+  int threads_;
+
+  // dense codes of both strings and the symbols x symbols scores of the
+  // symbols they use
+  vector<uint8_t> firstCodes_, secondCodes_;
+  vector<int32_t> table_;
+  int symbols_;
+
+  // kept from pair to pair so the buffers only grow: the kernels' scratch
+  // memory, the reversed prefixes and scores of findStart() and the
+  // engine aligning the hit's substrings
+  vector<uint8_t> kernelScratch_;
+  vector<uint8_t> reversedFirst_, reversedSecond_;
+  vector<int32_t> anchorTable_;
+  AffineEditDistance global_;
+
+  void encode();
+  int score(int x, int y) const { return x == y ? match_ : -mismatch_; }
+  Hit findStart(const Hit& end);
+};
+
+/*
+Input of the local alignment kernels: both strings as dense codes, the
+symbols x symbols scores, row major, and the gap penalties. The first string
+runs down the rows and the second along the columns.
+Kernels return the best score with the cell it ends at, as the number of
+characters of each string up to it. Ties go to the first column, then the
+first row, reaching the score; a score of 0 ends at 0, 0. The SIMD kernels
+take stripedScratchSize(rows, second, columns, 2) bytes of scratch memory
+(see StripedScratch.hpp).
+*/
+struct LocalAlignmentProblem {
+  const uint8_t* first;
+  int rows;
+  const uint8_t* second;
+  int columns;
+  const int32_t* score;
+  int symbols;
+  int gapOpen;
+  int gapExtend;
+};
+
+struct LocalAlignmentEnd {
+  int score;
+  int row;
+  int column;
+};
+
+LocalAlignmentEnd localAlignmentScalar(const LocalAlignmentProblem& problem);
+LocalAlignmentEnd localAlignmentSse42(const LocalAlignmentProblem& problem,
+                                      bool wide, uint8_t* scratch);
+LocalAlignmentEnd localAlignmentAvx2(const LocalAlignmentProblem& problem,
+                                     bool wide, uint8_t* scratch);
+
+#endif
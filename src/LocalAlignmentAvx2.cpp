@@ -0,0 +1,10 @@
+#include "LocalAlignment.hpp"
+#include "LocalAlignmentKernel.hpp"
+#include "StripedKernelOps.hpp"
+
+// striped Smith-Waterman kernel for AVX2; built with -mavx2
+LocalAlignmentEnd localAlignmentAvx2(const LocalAlignmentProblem& problem,
+                                     bool wide, uint8_t* scratch) {
+  return wide ? stripedLocalAlignment<Avx2Wide>(problem, scratch)
+              : stripedLocalAlignment<Avx2Narrow>(problem, scratch);
+}
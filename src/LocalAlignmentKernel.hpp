@@ -0,0 +1,137 @@
+#ifndef LOCALALIGNMENTKERNEL_HPP
+#define LOCALALIGNMENTKERNEL_HPP
+
+#include <stdint.h>
+
+#include "LocalAlignment.hpp"
+#include "StripedScratch.hpp"
+
+/*
+Farrar's striped Smith-Waterman over a table of code scores (see
+LocalAlignmentProblem), shared by the SIMD kernels of LocalAlignment. Ops is
+one of the vector types of StripedKernelOps.hpp; its subtraction saturating
+at 0 is the floor of the local recurrence. The layout is the one of
+stripedAffineEditDistance(), with scores to maximize instead of costs:
+profile entries are scores plus a bias that makes them non-negative, which
+is subtracted again after adding them.
+The best score of each column is only looked up in its rows when the
+column beats the best so far, which happens at most once per column.
+Padding rows past the end score at most what the rows above them scored,
+so they never beat a real row.
+The caller passes stripedScratchSize(rows, second, columns, 2) bytes of
+scratch memory.
+*/
+template <class Ops>
+static LocalAlignmentEnd stripedLocalAlignment(
+    const LocalAlignmentProblem& problem, uint8_t* scratch) {
+  typedef typename Ops::V V;
+  typedef typename Ops::Score Score;
+  const int LANES = Ops::LANES;
+
+  LocalAlignmentEnd best = {0, 0, 0};
+  int n = problem.rows;
+  int m = problem.columns;
+  if (n == 0 || m == 0) return best;
+  const uint8_t* first = problem.first;
+  const uint8_t* second = problem.second;
+  int seg = (n + LANES - 1) / LANES;
+  int size = seg * LANES;
+
+  int bias = 0;
+  for (int i = 0; i < problem.symbols * problem.symbols; i++) {
+    if (-problem.score[i] > bias) bias = -problem.score[i];
+  }
+
+  // one score profile per symbol of second
+  int* profileIndex = (int*)scratch;
+  for (int c = 0; c < problem.symbols; c++) profileIndex[c] = -1;
+  int profiles = 0;
+  for (int j = 0; j < m; j++) {
+    if (profileIndex[second[j]] < 0) profileIndex[second[j]] = profiles++;
+  }
+  // h holds the scores of the current column, e those of paths ending with
+  // an insert in the next one
+  Score* h = (Score*)(scratch + STRIPED_INDEX_BYTES);
+  Score* e = h + size;
+  Score* profile = e + size;
+  for (int s = 0; s < size * (profiles + 2); s++) h[s] = 0;
+  for (int i = 0; i < n; i++) {
+    int at = (i % seg) * LANES + i / seg;
+    const int32_t* scores = problem.score + first[i] * problem.symbols;
+    for (int c = 0; c < problem.symbols; c++) {
+      if (profileIndex[c] >= 0) {
+        profile[profileIndex[c] * size + at] = (Score)(scores[c] + bias);
+      }
+    }
+  }
+
+  Score lanes[LANES];
+
+  V zero = Ops::set1(0);
+  V scoreBias = Ops::set1(bias);
+  V gapOpen = Ops::set1(problem.gapOpen);
+  V gapExtend = Ops::set1(problem.gapExtend);
+  V gapFirst = Ops::set1(problem.gapOpen + problem.gapExtend);
+  for (int j = 1; j <= m; j++) {
+    const Score* scores = &profile[profileIndex[second[j - 1]] * size];
+
+    V diagonal = Ops::shiftIn(Ops::load(&h[size - LANES]), 0);
+    V f = zero;
+    V columnBest = zero;
+    for (int s = 0; s < size; s += LANES) {
+      V above = Ops::load(&h[s]);
+      V insert = Ops::load(&e[s]);
+      V current =
+          Ops::subs(Ops::adds(diagonal, Ops::load(scores + s)), scoreBias);
+      current = Ops::max(Ops::max(current, insert), f);
+      Ops::store(&h[s], current);
+      columnBest = Ops::max(columnBest, current);
+      V opened = Ops::subs(current, gapFirst);
+      Ops::store(&e[s], Ops::max(Ops::subs(insert, gapExtend), opened));
+      f = Ops::max(Ops::subs(f, gapExtend), opened);
+      diagonal = above;
+    }
+
+    // lazy F: carry deletes across lane boundaries until none can raise a
+    // score or outlast a freshly opened gap
+    f = Ops::shiftIn(f, 0);
+    for (int s = 0; Ops::anyLess(Ops::subs(Ops::load(&h[s]), gapOpen), f);) {
+      V current = Ops::max(Ops::load(&h[s]), f);
+      Ops::store(&h[s], current);
+      columnBest = Ops::max(columnBest, current);
+      Ops::store(&e[s],
+                 Ops::max(Ops::load(&e[s]), Ops::subs(current, gapFirst)));
+      f = Ops::subs(f, gapExtend);
+      s += LANES;
+      if (s == size) {
+        s = 0;
+        f = Ops::shiftIn(f, 0);
+      }
+    }
+
+    if (!Ops::anyLess(Ops::set1(best.score), columnBest)) continue;
+    Ops::store(lanes, columnBest);
+    int top = 0;
+    for (int l = 0; l < LANES; l++) {
+      if (lanes[l] > top) top = lanes[l];
+    }
+    // the first row reaching it; rows of lane l are l * seg, l * seg + 1, ...
+    V below = Ops::set1(top - 1);
+    int row = n;
+    for (int s = 0; s < size; s += LANES) {
+      if (!Ops::anyLess(below, Ops::load(&h[s]))) continue;
+      for (int l = 0; l < LANES; l++) {
+        int i = l * seg + s / LANES;
+        if (h[s + l] == top && i < row) row = i;
+      }
+    }
+    if (row < n) {
+      best.score = top;
+      best.row = row + 1;
+      best.column = j;
+    }
+  }
+  return best;
+}
+
+#endif
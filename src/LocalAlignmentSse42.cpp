@@ -0,0 +1,10 @@
+#include "LocalAlignment.hpp"
+#include "LocalAlignmentKernel.hpp"
+#include "StripedKernelOps.hpp"
+
+// striped Smith-Waterman kernel for SSE4.2; built with -msse4.2
+LocalAlignmentEnd localAlignmentSse42(const LocalAlignmentProblem& problem,
+                                      bool wide, uint8_t* scratch) {
+  return wide ? stripedLocalAlignment<Sse42Wide>(problem, scratch)
+              : stripedLocalAlignment<Sse42Narrow>(problem, scratch);
+}
@@ -0,0 +1,172 @@
+#include "Metrics.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+#include <chrono>
+
+atomic<uint64_t> Metrics::wallNanoseconds_[PHASE_COUNT];
+atomic<uint64_t> Metrics::cpuNanoseconds_[PHASE_COUNT];
+atomic<uint64_t> Metrics::counters_[COUNTER_COUNT];
+
+static const char* PHASE_NAMES[] = {
+    "table_allocation", "table_generation", "table_load",
+    "string_offsets",   "fill",             "traceback",
+    "alignment",        "input",            "output"};
+
+static const char* COUNTER_NAMES[] = {"pairs", "blocks", "traceback_blocks",
+                                      "table_entries"};
+
+// the hardware events counted by startHardwareCounters()
+static const int HARDWARE_EVENTS = 4;
+static const char* HARDWARE_NAMES[] = {"cycles", "instructions",
+                                       "cache_misses", "branch_misses"};
+// their perf_event descriptors, -1 while not counting
+static int hardwareCounters[HARDWARE_EVENTS] = {-1, -1, -1, -1};
+
+// wall-clock and CPU time at startup, for the run totals
+static const chrono::steady_clock::time_point startTime =
+    chrono::steady_clock::now();
+
+static double wallSeconds() {
+  return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+static double clockSeconds(clockid_t clock) {
+  struct timespec now;
+  if (clock_gettime(clock, &now) != 0) return 0;
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+void Metrics::addTime(Phase phase, double wallSeconds, double cpuSeconds) {
+  wallNanoseconds_[phase].fetch_add(uint64_t(wallSeconds * 1e9),
+                                    memory_order_relaxed);
+  cpuNanoseconds_[phase].fetch_add(uint64_t(cpuSeconds * 1e9),
+                                   memory_order_relaxed);
+}
+
+double Metrics::threadCpuSeconds() {
+  return clockSeconds(CLOCK_THREAD_CPUTIME_ID);
+}
+
+/*
+  Opens one counter per event for the whole process. inherit carries the
+  counters into threads created afterwards, so this has to be called before
+  any worker thread starts. Kernel events are excluded so the counters work
+  with the default perf_event_paranoid setting.
+*/
+bool Metrics::startHardwareCounters() {
+#ifdef __linux__
+  static const uint64_t configs[HARDWARE_EVENTS] = {
+      PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+  bool any = false;
+  for (int i = 0; i < HARDWARE_EVENTS; i++) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = configs[i];
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    hardwareCounters[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    any = any || hardwareCounters[i] >= 0;
+  }
+  return any;
+#else
+  return false;
+#endif
+}
+
+// the count of a hardware event, or -1 if it is not counted
+static long long readHardwareCounter(int event) {
+  uint64_t value;
+  if (hardwareCounters[event] < 0 ||
+      read(hardwareCounters[event], &value, sizeof(value)) != sizeof(value)) {
+    return -1;
+  }
+  return (long long)value;
+}
+
+void Metrics::print(ostream& out) {
+  char line[128];
+  snprintf(line, sizeof(line), "%-20s %12s %12s\n", "phase", "wall (s)",
+           "cpu (s)");
+  out << line;
+  for (int p = 0; p < PHASE_COUNT; p++) {
+    snprintf(line, sizeof(line), "%-20s %12.6f %12.6f\n", PHASE_NAMES[p],
+             wallNanoseconds_[p] * 1e-9, cpuNanoseconds_[p] * 1e-9);
+    out << line;
+  }
+  snprintf(line, sizeof(line), "%-20s %12.6f %12.6f\n", "total",
+           chrono::duration<double>(chrono::steady_clock::now() - startTime)
+               .count(),
+           clockSeconds(CLOCK_PROCESS_CPUTIME_ID));
+  out << line;
+
+  for (int c = 0; c < COUNTER_COUNT; c++) {
+    snprintf(line, sizeof(line), "%-20s %12llu\n", COUNTER_NAMES[c],
+             (unsigned long long)counters_[c].load());
+    out << line;
+  }
+  for (int e = 0; e < HARDWARE_EVENTS; e++) {
+    long long value = readHardwareCounter(e);
+    if (value < 0) continue;
+    snprintf(line, sizeof(line), "%-20s %12lld\n", HARDWARE_NAMES[e], value);
+    out << line;
+  }
+}
+
+void Metrics::writeJson(ostream& out) {
+  char value[64];
+  out << "{\n  \"phases\": {";
+  for (int p = 0; p < PHASE_COUNT; p++) {
+    snprintf(value, sizeof(value), "%.9f", wallNanoseconds_[p] * 1e-9);
+    out << (p ? ",\n" : "\n") << "    \"" << PHASE_NAMES[p]
+        << "\": {\"wall_seconds\": " << value;
+    snprintf(value, sizeof(value), "%.9f", cpuNanoseconds_[p] * 1e-9);
+    out << ", \"cpu_seconds\": " << value << "}";
+  }
+  snprintf(value, sizeof(value), "%.9f",
+           chrono::duration<double>(chrono::steady_clock::now() - startTime)
+               .count());
+  out << "\n  },\n  \"total\": {\"wall_seconds\": " << value;
+  snprintf(value, sizeof(value), "%.9f", clockSeconds(CLOCK_PROCESS_CPUTIME_ID));
+  out << ", \"cpu_seconds\": " << value << "},\n  \"counters\": {";
+  for (int c = 0; c < COUNTER_COUNT; c++) {
+    out << (c ? ", " : "") << "\"" << COUNTER_NAMES[c]
+        << "\": " << counters_[c].load();
+  }
+  out << "}";
+
+  bool first = true;
+  for (int e = 0; e < HARDWARE_EVENTS; e++) {
+    long long count = readHardwareCounter(e);
+    if (count < 0) continue;
+    out << (first ? ",\n  \"hardware\": {" : ", ") << "\"" << HARDWARE_NAMES[e]
+        << "\": " << count;
+    first = false;
+  }
+  if (!first) out << "}";
+  out << "\n}\n";
+}
+
+PhaseTimer::PhaseTimer(Metrics::Phase phase, bool wall)
+    : phase_(phase),
+      wall_(wall),
+      startWall_(wall ? wallSeconds() : 0),
+      startCpu_(Metrics::threadCpuSeconds()) {}
+
+PhaseTimer::~PhaseTimer() {
+  Metrics::addTime(phase_, wall_ ? wallSeconds() - startWall_ : 0,
+                   Metrics::threadCpuSeconds() - startCpu_);
+}
@@ -0,0 +1,92 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <stdint.h>
+
+#include <atomic>
+#include <ostream>
+
+using namespace std;
+
+/*
+Process-wide performance metrics: wall-clock and CPU time per phase of the
+calculation, and counters of the work done. Phases are timed with
+PhaseTimer; the totals are plain atomic sums, updated once per phase rather
+than per block, so they cost nothing measurable and are always collected.
+Wall time is measured with a monotonic clock. CPU time is per thread: a
+phase that hands work to helper threads also times each helper with a
+PhaseTimer that records CPU time only. With several pairs calculated at once
+(see main) phases overlap, so their wall times add up to more than the run.
+Nothing is printed unless asked for with print() or writeJson().
+*/
+class Metrics {
+ public:
+  enum Phase {
+    TABLE_ALLOCATION,
+    TABLE_GENERATION,
+    TABLE_LOAD,
+    STRING_OFFSETS,
+    FILL,
+    TRACEBACK,
+    ALIGNMENT,
+    INPUT,
+    OUTPUT,
+    PHASE_COUNT
+  };
+
+  enum Counter {
+    // sequence pairs calculated
+    PAIRS,
+    // blocks of the edit matrix evaluated, each one table lookup
+    BLOCKS,
+    // blocks walked by a traceback
+    TRACEBACK_BLOCKS,
+    // submatrix table entries calculated, up front or on first use
+    TABLE_ENTRIES,
+    COUNTER_COUNT
+  };
+
+  static void addTime(Phase phase, double wallSeconds, double cpuSeconds);
+  static void add(Counter counter, uint64_t amount) {
+    counters_[counter].fetch_add(amount, memory_order_relaxed);
+  }
+
+  // CPU time of the calling thread, in seconds
+  static double threadCpuSeconds();
+
+  // counts hardware events (cycles, instructions, cache and branch misses)
+  // of the process and the threads it starts from now on, where Linux
+  // allows it; returns false if they are unavailable
+  static bool startHardwareCounters();
+
+  // a table of the phases and counters
+  static void print(ostream& out);
+  // the same as a JSON object
+  static void writeJson(ostream& out);
+
+ private:
+  static atomic<uint64_t> wallNanoseconds_[PHASE_COUNT];
+  static atomic<uint64_t> cpuNanoseconds_[PHASE_COUNT];
+  static atomic<uint64_t> counters_[COUNTER_COUNT];
+};
+
+/*
+Adds the time from its construction to its destruction to a phase. Timers
+of helper threads pass wall = false so the phase is not counted twice.
+*/
+class PhaseTimer {
+ public:
+  explicit PhaseTimer(Metrics::Phase phase, bool wall = true);
+  ~PhaseTimer();
+
+ private:
+  Metrics::Phase phase_;
+  bool wall_;
+  double startWall_;
+  double startCpu_;
+
+  PhaseTimer(const PhaseTimer&);
+  PhaseTimer& operator=(const PhaseTimer&);
+};
+
+#endif
@@ -0,0 +1,74 @@
+#include "PackedSequence.hpp"
+
+PackedSequence::PackedSequence() : size_(0), alphabet_("ATGC") {}
+
+PackedSequence::PackedSequence(const string& data, const string& alphabet)
+    : size_(data.size()), alphabet_(alphabet) {
+  int codes[256];
+  for (int c = 0; c < 256; c++) codes[c] = -1;
+  for (int k = 0; k < 4 && k < (int)alphabet.size(); k++) {
+    codes[(unsigned char)alphabet[k]] = k;
+  }
+
+  words_.assign((size_ + 31) / 32, 0);
+  for (size_t i = 0; i < size_; i++) {
+    int code = codes[(unsigned char)data[i]];
+    if (code < 0) {
+      // extend the current run or start a new one
+      if (!exceptions_.empty() &&
+          exceptions_.back().start + exceptions_.back().length == i &&
+          exceptions_.back().symbol == data[i]) {
+        exceptions_.back().length++;
+      } else {
+        Exception run = {i, 1, data[i]};
+        exceptions_.push_back(run);
+      }
+      continue;
+    }
+    words_[i >> 5] |= (uint64_t)code << (62 - 2 * (i & 31));
+  }
+}
+
+size_t PackedSequence::memoryBytes() const {
+  return words_.size() * sizeof(uint64_t) +
+         exceptions_.size() * sizeof(Exception);
+}
+
+// index of the first exception run ending after position i, found by
+// binary search over the run starts
+size_t PackedSequence::firstExceptionAfter(size_t i) const {
+  size_t low = 0;
+  size_t high = exceptions_.size();
+  while (low < high) {
+    size_t middle = (low + high) / 2;
+    if (exceptions_[middle].start + exceptions_[middle].length <= i) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+bool PackedSequence::hasException(size_t i, size_t count) const {
+  size_t run = firstExceptionAfter(i);
+  return run < exceptions_.size() && exceptions_[run].start < i + count;
+}
+
+char PackedSequence::at(size_t i) const {
+  size_t run = firstExceptionAfter(i);
+  if (run < exceptions_.size() && exceptions_[run].start <= i) {
+    return exceptions_[run].symbol;
+  }
+  return alphabet_[code(i)];
+}
+
+string PackedSequence::unpack() const {
+  string data(size_, alphabet_[0]);
+  for (size_t i = 0; i < size_; i++) data[i] = alphabet_[code(i)];
+  for (size_t run = 0; run < exceptions_.size(); run++) {
+    const Exception& e = exceptions_[run];
+    data.replace(e.start, e.length, e.length, e.symbol);
+  }
+  return data;
+}
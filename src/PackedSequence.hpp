@@ -0,0 +1,73 @@
+#ifndef PACKEDSEQUENCE_HPP
+#define PACKEDSEQUENCE_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/*
+Sequence data stored in 2 bits per symbol. The alphabet has four symbols,
+coded by their index in it; every other character (N, lowercase, ...) is
+kept in a list of exception runs and stored as code 0, the code Solver's
+tables give characters outside their alphabet.
+Codes are packed most significant first, 32 per word, so any run of up to
+32 codes reads as one base-4 number with a shift and a mask; see codes().
+*/
+class PackedSequence {
+ public:
+  // a run of length equal characters outside the alphabet
+  struct Exception {
+    size_t start;
+    size_t length;
+    char symbol;
+  };
+
+  PackedSequence();
+  // alphabet needs exactly four distinct characters
+  explicit PackedSequence(const string& data, const string& alphabet = "ATGC");
+
+  size_t size() const { return size_; }
+  const string& getAlphabet() const { return alphabet_; }
+  // exception runs in increasing order of position
+  const vector<Exception>& getExceptions() const { return exceptions_; }
+  // bytes used by the packed words and the exceptions
+  size_t memoryBytes() const;
+
+  // the character at position i
+  char at(size_t i) const;
+  // the original data
+  string unpack() const;
+
+  // 2-bit code of position i; 0 for exceptions
+  inline int code(size_t i) const {
+    return (words_[i >> 5] >> (62 - 2 * (i & 31))) & 3;
+  }
+
+  // codes of positions [i, i + count), 1 <= count <= 32, as a base-4 number
+  // with the code of position i as its most significant digit
+  inline uint64_t codes(size_t i, int count) const {
+    size_t word = i >> 5;
+    int shift = 2 * (i & 31);
+    uint64_t bits = words_[word] << shift;
+    if (shift + 2 * count > 64) bits |= words_[word + 1] >> (64 - shift);
+    return bits >> (64 - 2 * count);
+  }
+
+  // whether some position in [i, i + count) holds an exception
+  bool hasException(size_t i, size_t count) const;
+
+ private:
+  vector<uint64_t> words_;
+  size_t size_;
+  string alphabet_;
+  vector<Exception> exceptions_;
+
+  // index of the first exception run ending after position i
+  size_t firstExceptionAfter(size_t i) const;
+};
+
+#endif
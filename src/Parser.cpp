@@ -1,58 +1,115 @@
-#include "Parser.hpp"
-
-#include <iostream>
-
-// contructor for parser; takes string filename which should be full path to .fa
-// file
-Parser::Parser(const char* filename) {
-  Parser::in_.open(filename, ifstream::in);
-};
-
-// destructor, close input stream on destruction
-Parser::~Parser() { in_.close(); }
-
-// reads sequences from file and returns them in a vector
-const vector<Sequence*> Parser::readSequences() {
-  vector<Sequence*> sequences;
-
-  while (!Parser::in_.eof()) {
-    string line;
-    getline(Parser::in_, line);
-
-    if (line.size() == 0) continue;
-
-    string identifier;
-    string sequence;
-
-    if (line.at(0) == '>') {
-      identifier = line.substr(1, line.find_first_of(" \n|") - 1);
-
-      char next = Parser::in_.peek();
-
-      while (next != '>' && !Parser::in_.eof()) {
-        getline(Parser::in_, line);
-        sequence += line;
-
-        next = Parser::in_.peek();
-      }
-
-    } else {
-      continue;
-    }
-
-    Sequence* seq = new Sequence(identifier, sequence);
-    sequences.push_back(seq);
-  }
-
-  return sequences;
-};
-
-/* 'Unit' test
-int main()
-{
-    Parser p("test/data/Escherichia_coli.GCA_000967155.1.30.dna.toplevel.fa");
-    vector<Sequence*> sequences = p.readSequences();
-
-    cout << sequences.size();
-}
-*/
+#include "Parser.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <utility>
+
+// contructor for parser; takes string filename which should be full path to .fa
+// file
+Parser::Parser(const char* filename) : data_(NULL), size_(0) {
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    error_ = string("Could not open ") + filename + ": " + strerror(errno);
+    return;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    error_ = string("Could not read ") + filename + ": " + strerror(errno);
+  } else if (info.st_size > 0) {
+    void* mapped =
+        mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped != MAP_FAILED) {
+      madvise(mapped, info.st_size, MADV_SEQUENTIAL);
+      data_ = (const char*)mapped;
+      size_ = info.st_size;
+    } else {
+      error_ = string("Could not map ") + filename + ": " + strerror(errno);
+    }
+  }
+  // the mapping stays valid after the descriptor is closed
+  close(fd);
+}
+
+// destructor, unmaps the file
+Parser::~Parser() {
+  if (data_ != NULL) munmap((void*)data_, size_);
+}
+
+// end of the line starting at p: its '\n', or end if it is the last one
+static const char* lineEnd(const char* p, const char* end) {
+  const char* newline = (const char*)memchr(p, '\n', end - p);
+  return newline != NULL ? newline : end;
+}
+
+// start of the first record header at or after p: a '>' at the start of a
+// line, or end if there is none. '>' never occurs in sequence data, so
+// searching for it skips whole sequences at once.
+static const char* nextHeader(const char* p, const char* begin,
+                              const char* end) {
+  while (p < end) {
+    const char* mark = (const char*)memchr(p, '>', end - p);
+    if (mark == NULL) return end;
+    if (mark == begin || mark[-1] == '\n') return mark;
+    p = mark + 1;
+  }
+  return end;
+}
+
+// reads sequences from file and returns them in a vector
+const vector<Sequence*> Parser::readSequences() {
+  vector<Sequence*> sequences;
+  if (data_ == NULL) return sequences;
+
+  const char* begin = data_;
+  const char* end = data_ + size_;
+  const char* p = nextHeader(begin, begin, end);
+  while (p < end) {
+    const char* headerEnd = lineEnd(p, end);
+
+    // the identifier runs up to the first space or '|' of the header
+    const char* name = p + 1;
+    const char* nameEnd = name;
+    while (nameEnd < headerEnd && *nameEnd != ' ' && *nameEnd != '|') {
+      nameEnd++;
+    }
+    if (nameEnd == headerEnd && nameEnd > name && nameEnd[-1] == '\r') {
+      nameEnd--;
+    }
+    string identifier(name, nameEnd);
+
+    // the sequence lines run up to the next header; copy them without their
+    // line breaks into one buffer sized for the whole record
+    const char* body = headerEnd < end ? headerEnd + 1 : end;
+    const char* bodyEnd = nextHeader(body, begin, end);
+    string sequence;
+    sequence.reserve(bodyEnd - body);
+    for (const char* line = body; line < bodyEnd;) {
+      const char* next = lineEnd(line, bodyEnd);
+      const char* stop = next;
+      if (stop > line && stop[-1] == '\r') stop--;
+      sequence.append(line, stop - line);
+      line = next + 1;
+    }
+
+    sequences.push_back(new Sequence(identifier, move(sequence)));
+    p = bodyEnd;
+  }
+
+  return sequences;
+};
+
+/* 'Unit' test
+int main()
+{
+    Parser p("test/data/Escherichia_coli.GCA_000967155.1.30.dna.toplevel.fa");
+    vector<Sequence*> sequences = p.readSequences();
+
+    cout << sequences.size();
+}
+*/
@@ -1,26 +1,39 @@
-#ifndef PARSER_HPP
-#define PARSER_HPP
-
-#include <fstream>
-#include <vector>
-
-#include "Sequence.hpp"
-
-/*
-Parser for .fa files in FASTA format.
-*/
-class Parser {
- private:
-  ifstream in_;
-
- public:
-  // contructor for parser; takes string filename which should be full path to
-  // .fa file
-  Parser(const char* filename);
-  ~Parser();
-
-  // reads sequences from file and returns them in a vector
-  const vector<Sequence*> readSequences();
-};
-
-#endif
+#ifndef PARSER_HPP
+#define PARSER_HPP
+
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+#include "Sequence.hpp"
+
+/*
+Parser for .fa files in FASTA format. The file is memory-mapped and record
+boundaries are found with memchr, so parsing runs at the speed the file can
+be paged in; the only copy is each sequence's data, with the line breaks
+stripped, into a buffer sized once per sequence.
+*/
+class Parser {
+ private:
+  // read-only mapping of the whole file, NULL if empty or not opened
+  const char* data_;
+  size_t size_;
+  // why the file could not be read, empty if it could
+  string error_;
+
+ public:
+  // contructor for parser; takes string filename which should be full path to
+  // .fa file
+  Parser(const char* filename);
+  ~Parser();
+
+  // whether the file could not be opened or mapped; getError() says why
+  bool failed() const { return !error_.empty(); }
+  const string& getError() const { return error_; }
+
+  // reads sequences from file and returns them in a vector
+  const vector<Sequence*> readSequences();
+};
+
+#endif
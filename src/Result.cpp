@@ -1,13 +1,56 @@
-#include "Result.hpp"
-
-// construct Result object from sequences and score
-Result::Result(Sequence* a, Sequence* b, double score)
-    : a_(a),
-      b_(b),
-      score_(score){
-
-      };
-
-Result::~Result(){
-
-};
+#include "Result.hpp"
+
+// construct Result object from sequences and score
+Result::Result(Sequence* a, Sequence* b, double score)
+    : a_(a),
+      b_(b),
+      score_(score),
+      symbolsA_(a->size()),
+      symbolsB_(b->size()),
+      startA_(0),
+      startB_(0),
+      sourceSizeA_(a->size()),
+      sourceSizeB_(b->size()),
+      owner_(false){
+
+      };
+
+// construct Result object from aligned sequences, which it then owns
+Result::Result(Sequence* a, Sequence* b, double score, size_t symbolsA,
+               size_t symbolsB)
+    : a_(a),
+      b_(b),
+      score_(score),
+      symbolsA_(symbolsA),
+      symbolsB_(symbolsB),
+      startA_(0),
+      startB_(0),
+      sourceSizeA_(symbolsA),
+      sourceSizeB_(symbolsB),
+      owner_(true){
+
+      };
+
+// construct Result object from aligned regions of the source sequences
+Result::Result(Sequence* a, Sequence* b, double score, size_t startA,
+               size_t symbolsA, size_t sourceSizeA, size_t startB,
+               size_t symbolsB, size_t sourceSizeB)
+    : a_(a),
+      b_(b),
+      score_(score),
+      symbolsA_(symbolsA),
+      symbolsB_(symbolsB),
+      startA_(startA),
+      startB_(startB),
+      sourceSizeA_(sourceSizeA),
+      sourceSizeB_(sourceSizeB),
+      owner_(true){
+
+      };
+
+Result::~Result(){
+  if (owner_) {
+    delete a_;
+    delete b_;
+  }
+};
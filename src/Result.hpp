@@ -1,29 +1,66 @@
-#ifndef RESULT_HPP
-#define RESULT_HPP
-
-#include "Sequence.hpp"
-
-/*
-Class representing a result of single sequence alignment. Consists of a score
-(edit distance) and aligned sequences.
-*/
-class Result {
- private:
-  Sequence* a_;
-  Sequence* b_;
-  double score_;
-
- public:
-  // construct Result object from sequences and score
-  Result(Sequence* a, Sequence* b, double score);
-  ~Result();
-
-  // getter for score
-  double getScore() const { return score_; }
-  // getter for first sequence
-  Sequence* getA() { return a_; }
-  // getter for second sequence
-  Sequence* getB() { return b_; }
-};
-
-#endif
+#ifndef RESULT_HPP
+#define RESULT_HPP
+
+#include <stddef.h>
+
+#include "Sequence.hpp"
+
+/*
+Class representing a result of single sequence alignment. Consists of a score
+(edit distance) and aligned sequences, with the number of symbols (non-gap
+characters) in each, which the producer knows without scanning the data.
+A local alignment covers only part of each input sequence: the aligned
+symbols start at an offset into a source sequence of a given size.
+*/
+class Result {
+ private:
+  Sequence* a_;
+  Sequence* b_;
+  double score_;
+  size_t symbolsA_;
+  size_t symbolsB_;
+  size_t startA_;
+  size_t startB_;
+  size_t sourceSizeA_;
+  size_t sourceSizeB_;
+  // whether the sequences were made for this result and are deleted with it
+  bool owner_;
+
+  Result(const Result&);
+  Result& operator=(const Result&);
+
+ public:
+  // construct Result object from the input sequences and score; the sequences
+  // have no gaps and stay owned by the caller
+  Result(Sequence* a, Sequence* b, double score);
+  // construct Result object from aligned sequences holding symbolsA and
+  // symbolsB symbols; the result takes ownership of the sequences
+  Result(Sequence* a, Sequence* b, double score, size_t symbolsA,
+         size_t symbolsB);
+  // construct Result object from aligned regions of two sequences: symbolsA
+  // symbols starting at startA of a source sequence of sourceSizeA symbols,
+  // and likewise for b; the result takes ownership of the sequences
+  Result(Sequence* a, Sequence* b, double score, size_t startA,
+         size_t symbolsA, size_t sourceSizeA, size_t startB, size_t symbolsB,
+         size_t sourceSizeB);
+  ~Result();
+
+  // getter for score
+  double getScore() const { return score_; }
+  // getter for first sequence
+  Sequence* getA() { return a_; }
+  // getter for second sequence
+  Sequence* getB() { return b_; }
+  // number of non-gap characters of the first sequence
+  size_t getSymbolsA() const { return symbolsA_; }
+  // number of non-gap characters of the second sequence
+  size_t getSymbolsB() const { return symbolsB_; }
+  // offset of the first aligned symbol in each source sequence
+  size_t getStartA() const { return startA_; }
+  size_t getStartB() const { return startB_; }
+  // number of symbols of each source sequence
+  size_t getSourceSizeA() const { return sourceSizeA_; }
+  size_t getSourceSizeB() const { return sourceSizeB_; }
+};
+
+#endif
@@ -1,12 +1,27 @@
-#include "Sequence.hpp"
-
-// Constructor for Sequence object from identifier and string representation
-Sequence::Sequence(const string& identifier, const string& data)
-    : identifier_(identifier),
-      data_(data){
-
-      };
-
-Sequence::~Sequence(){
-
-};
+#include "Sequence.hpp"
+
+#include <utility>
+
+// Constructor for Sequence object from identifier and string representation
+Sequence::Sequence(const string& identifier, string data)
+    : identifier_(identifier),
+      data_(move(data)),
+      packed_(NULL){
+
+      };
+
+Sequence::~Sequence(){
+  delete packed_;
+};
+
+// replaces the data by its packed form; packing twice keeps the first one
+void Sequence::pack(const string& alphabet) {
+  if (packed_ != NULL) return;
+  packed_ = new PackedSequence(data_, alphabet);
+  string().swap(data_);
+}
+
+// a copy of the data, unpacked if needed
+string Sequence::unpack() const {
+  return packed_ != NULL ? packed_->unpack() : data_;
+}
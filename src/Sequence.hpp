@@ -1,28 +1,47 @@
-#ifndef SEQUENCE_HPP
-#define SEQUENCE_HPP
-
-#include <string>
-
-using namespace std;
-
-/*
-Class representing a sequence of chromosome. Consists of sequence identifier and
-string representation.
-*/
-class Sequence {
- private:
-  string identifier_;
-  string data_;
-
- public:
-  // Constructor for Sequence object from identifier and string representation
-  Sequence(const string& identifier, const string& data);
-  ~Sequence();
-
-  // getter for identifier
-  const string getIdentifier() const { return identifier_; }
-  // getter for string representation of sequence
-  const string getData() const { return data_; }
-};
-
-#endif
+#ifndef SEQUENCE_HPP
+#define SEQUENCE_HPP
+
+#include <string>
+
+#include "PackedSequence.hpp"
+
+using namespace std;
+
+/*
+Class representing a sequence of chromosome. Consists of sequence identifier and
+string representation. The data can be packed to 2 bits per base (see
+PackedSequence), after which only the packed form is kept.
+*/
+class Sequence {
+ private:
+  string identifier_;
+  string data_;
+  // packed data, NULL unless pack() was called; data_ is empty then
+  PackedSequence* packed_;
+
+  Sequence(const Sequence&);
+  Sequence& operator=(const Sequence&);
+
+ public:
+  // Constructor for Sequence object from identifier and string representation;
+  // pass the data as an rvalue to move it in instead of copying
+  Sequence(const string& identifier, string data);
+  ~Sequence();
+
+  // getter for identifier
+  const string& getIdentifier() const { return identifier_; }
+  // getter for string representation of an unpacked sequence; packed ones
+  // return an empty string, see unpack()
+  const string& getData() const { return data_; }
+  // number of symbols, packed or not
+  size_t size() const { return packed_ != NULL ? packed_->size() : data_.size(); }
+
+  // replaces the data by its packed form over the given four-symbol alphabet
+  void pack(const string& alphabet = "ATGC");
+  bool isPacked() const { return packed_ != NULL; }
+  const PackedSequence& getPacked() const { return *packed_; }
+  // a copy of the data, unpacked if needed
+  string unpack() const;
+};
+
+#endif
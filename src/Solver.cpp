@@ -1,4 +1,6 @@
 #include "Solver.hpp"
+
+#include <algorithm>
 //#include "SubmatrixCalculator.hpp"
 //#include "SubmatrixCalculator.cpp"
 
@@ -10,8 +12,113 @@
     the two aligned sequences, while function calculate() will return just
     the edit distance and thus use less memory.
 */
-Solver::Solver(string str_a, string str_b, string _alphabet,
-               int _submatrix_dim) {
+Solver::Solver(const string& str_a, const string& str_b,
+               string _alphabet, int _submatrix_dim, const EditCosts& costs) {
+    this->alphabet = _alphabet;
+    this->threads = 1;
+    this->end_gaps = 0;
+
+    if (_submatrix_dim > 0) {
+        this->submatrix_dim = _submatrix_dim;
+    } else {
+        this->submatrix_dim =
+            chooseDimension(max(str_a.size(), str_b.size()), _alphabet, costs);
+    }
+
+    // generate all possible submatrices for the given alphabet, dimension and
+    // costs, or reuse them if some earlier solver already did
+    this->subm_calc = SubmatrixRegistry::get(
+        this->submatrix_dim, this->alphabet, this->BLANK_CHAR, costs);
+
+    reset(str_a, str_b);
+}
+
+/*
+    Constructs a solver on top of an existing table; the dimension and
+    alphabet are taken from the table.
+*/
+Solver::Solver(const string& str_a, const string& str_b,
+               const SubmatrixCalculator* table) {
+    this->subm_calc = table;
+    this->threads = 1;
+    this->end_gaps = 0;
+    this->alphabet = table->getAlphabet();
+    this->submatrix_dim = table->getDimension();
+
+    reset(str_a, str_b);
+}
+
+/*
+    Constructs a solver over packed sequences; the table alphabet is theirs,
+    so full blocks are read straight from the packed codes.
+*/
+Solver::Solver(const PackedSequence& str_a, const PackedSequence& str_b,
+               int _submatrix_dim, const EditCosts& costs) {
+    this->alphabet = str_a.getAlphabet();
+    this->threads = 1;
+    this->end_gaps = 0;
+
+    if (_submatrix_dim > 0) {
+        this->submatrix_dim = _submatrix_dim;
+    } else {
+        this->submatrix_dim = chooseDimension(max(str_a.size(), str_b.size()),
+                                              this->alphabet, costs);
+    }
+    this->subm_calc = SubmatrixRegistry::get(
+        this->submatrix_dim, this->alphabet, this->BLANK_CHAR, costs);
+
+    reset(str_a, str_b);
+}
+
+/*
+    Sets the number of threads filling the edit matrix; 0 uses every
+    available core. The result does not depend on it.
+*/
+void Solver::setThreads(int _threads) {
+    this->threads = _threads;
+}
+
+/*
+    The end gaps of the strings in the other order when swap is set:
+    the first string's ends become the second's and the other way round.
+*/
+static int swap_end_gaps(int end_gaps, bool swap) {
+    if (!swap) return end_gaps;
+    int first = Solver::FREE_FIRST_START | Solver::FREE_FIRST_END;
+    int second = Solver::FREE_SECOND_START | Solver::FREE_SECOND_END;
+    return (end_gaps & first) << 2 | (end_gaps & second) >> 2;
+}
+
+/*
+    Sets the free end gaps (see EndGaps). They only apply to calculate(),
+    calculate_with_path() and calculate_with_path_linear(); the bounded
+    calculations fall back to calculate() when any is set.
+*/
+void Solver::setFreeEndGaps(int _end_gaps) {
+    this->end_gaps = _end_gaps;
+    this->free_ends = swap_end_gaps(_end_gaps, this->swapped);
+}
+
+/*
+    Calculates the submatrix dimension using the longer string to reduce
+    complexity. Wider steps of larger indel costs multiply the table size,
+    so they lower the dimension, down to the largest one the step codes
+    allow.
+*/
+int Solver::chooseDimension(int longer_size, const string& alphabet,
+                            const EditCosts& costs) {
+    if (longer_size <= 1) return 1;
+    int step_base = 2 * max(costs.deleteCost, costs.insertCost) + 1;
+    int dim = ceil(log(longer_size) / log(step_base * alphabet.size()) / 2);
+    dim = min(dim, SubmatrixCalculator::maxDimension(costs));
+    return dim > 0 ? dim : 1;
+}
+
+/*
+    Prepares the solver for a new pair of strings. The submatrix table is kept,
+    so re-targeting a solver costs only the string offset calculation.
+*/
+void Solver::reset(const string& str_a, const string& str_b) {
     /*
         We want the calculation matrix columns to represent the shorter string
         because both the time complexity and the space complexity in the path-less
@@ -19,97 +126,181 @@ Solver::Solver(string str_a, string str_b, string _alphabet,
         submatrix-combining complexities; the submatrix-combining space complexity
        is
         "negligible" in total).
+        Swapping the strings swaps the insert and delete costs and transposes
+        the substitution matrix, so asymmetric costs keep the given order.
     */
-    if (str_a.size() >= str_b.size()) {
+    this->swapped = str_a.size() < str_b.size() && subm_calc->isSymmetric();
+    if (!this->swapped) {
         this->string_a = str_a;
         this->string_b = str_b;
     } else {
         this->string_a = str_b;
         this->string_b = str_a;
     }
+    this->packed_a = NULL;
+    this->packed_b = NULL;
 
-    this->alphabet = _alphabet;
+    string_a_real_size = string_a.size();
+    string_b_real_size = string_b.size();
 
-    if (_submatrix_dim > 0) {
-        this->submatrix_dim = _submatrix_dim;
-    } else {
-        // calculate the submatrix dimension using the longer string to reduce
-        // complexity
-        this->submatrix_dim =
-            ceil(log(this->string_a.size()) / log(3 * _alphabet.size()) / 2);
+    prepare();
+}
+
+/*
+    Prepares the solver for a new pair of packed sequences. Sequences packed
+    with a different alphabet than the table's are unpacked instead.
+*/
+void Solver::reset(const PackedSequence& str_a, const PackedSequence& str_b) {
+    if (str_a.getAlphabet() != this->alphabet ||
+        str_b.getAlphabet() != this->alphabet) {
+        reset(str_a.unpack(), str_b.unpack());
+        return;
     }
 
-    cout << "Submatrix dimension: " << submatrix_dim << endl;
-    cout << "String A size: " << string_a.size() << endl;
-    cout << "String B size: " << string_b.size() << endl;
+    this->swapped = str_a.size() < str_b.size() && subm_calc->isSymmetric();
+    this->packed_a = swapped ? &str_b : &str_a;
+    this->packed_b = swapped ? &str_a : &str_b;
+    this->string_a.clear();
+    this->string_b.clear();
 
-    string_a_real_size = string_a.size();
-    string_b_real_size = string_b.size();
+    string_a_real_size = packed_a->size();
+    string_b_real_size = packed_b->size();
 
-    // pad the strings to fit dimension
-    if (string_a.size() % submatrix_dim != 0) {
-        int cnt = submatrix_dim - string_a.size() % submatrix_dim;
-        while (cnt--) {
-            string_a += this->BLANK_CHAR;
-        }
-    }
-    if (string_b.size() % submatrix_dim != 0) {
-        int cnt = submatrix_dim - string_b.size() % submatrix_dim;
-        while (cnt--) {
-            string_b += this->BLANK_CHAR;
-        }
-    }
+    prepare();
+}
+
+/*
+    Pads the strings to whole blocks and calculates their symbol codes and
+    block string indices.
+*/
+void Solver::prepare() {
+    PhaseTimer timer(Metrics::STRING_OFFSETS);
+    this->free_ends = swap_end_gaps(end_gaps, swapped);
 
     // calculate the dimensions of the edit matrix (the number of submatrices)
-    this->row_num = string_a.size() / submatrix_dim;
-    this->column_num = string_b.size() / submatrix_dim;
-    cout << "Submatrices in edit table: " << row_num << "x" << column_num << endl;
+    this->row_num = (string_a_real_size + submatrix_dim - 1) / submatrix_dim;
+    this->column_num = (string_b_real_size + submatrix_dim - 1) / submatrix_dim;
 
-    // generate all possible submatrices for the given alphabet and dimension
-    this->subm_calc = new SubmatrixCalculator(this->submatrix_dim, this->alphabet,
-            this->BLANK_CHAR);
+    // symbol codes of the strings padded with blanks to fit dimension, used
+    // to address the table and to backtrack without building substrings;
+    // packed strings are decoded on demand instead, see read_codes()
+    uint8_t blank = subm_calc->symbolCode(BLANK_CHAR);
+    if (packed_a != NULL) {
+        vector<uint8_t>().swap(codes_a);
+        vector<uint8_t>().swap(codes_b);
+    } else {
+        this->codes_a.assign(row_num * submatrix_dim, blank);
+        this->codes_b.assign(column_num * submatrix_dim, blank);
+        for (int i = 0; i < string_a_real_size; i++) {
+            codes_a[i] = subm_calc->symbolCode(string_a[i]);
+        }
+        for (int i = 0; i < string_b_real_size; i++) {
+            codes_b[i] = subm_calc->symbolCode(string_b[i]);
+        }
+    }
 
-    subm_calc->calculate();
+    // results of a previous pair are no longer valid
+    all_columns.clear();
+    all_rows.clear();
 
     calculateStringOffsets();
 }
 
 /*
-    Calculates the submatrix address offset for each initial string that can
-    appear during calculation, i.e. sequentially for each substring of
-    string_a and string_b of length submatrix_dim. Saves time when combining
-    submatrix results.
+    Calculates the table string index of each block that can appear during
+    calculation, i.e. sequentially for each substring of string_a and
+    string_b of length submatrix_dim. Saves time when combining submatrix
+    results.
 */
 void Solver::calculateStringOffsets(){
-    this->str_a_offsets.resize(row_num + 1);
-    this->str_b_offsets.resize(column_num + 1);
+    this->str_a_indices.resize(row_num + 1);
+    this->str_b_indices.resize(column_num + 1);
 
-    string tempBlank = "";
-    string tempBlank2 = "";
-    for (int i = 0; i < this->submatrix_dim; i++){
-        tempBlank += alphabet[0];
-        tempBlank2 += '0';
+    if (packed_a != NULL && alphabet.size() == 4) {
+        calculatePackedOffsets(true, str_a_indices);
+        calculatePackedOffsets(false, str_b_indices);
+        return;
     }
 
     for (int i = 1; i <= row_num; i++){
-        str_a_offsets[i] = subm_calc->getOffset(string_a.substr((i - 1) * submatrix_dim, submatrix_dim), tempBlank, tempBlank2, tempBlank2);
+        str_a_indices[i] = subm_calc->getStringIndex(&codes_a[(i - 1) * submatrix_dim]);
     }
 
     for (int i = 1; i <= column_num; i++){
-        str_b_offsets[i] = subm_calc->getOffset(tempBlank, string_b.substr((i - 1) * submatrix_dim, submatrix_dim), tempBlank2, tempBlank2);
+        str_b_indices[i] = subm_calc->getStringIndex(&codes_b[(i - 1) * submatrix_dim]);
+    }
+}
+
+/*
+    calculateStringOffsets() for packed_a (first) or packed_b with the
+    table's alphabet: a full block is a base-4 number of packed codes, which
+    is its index among the strings without blanks. Blocks holding an
+    exception or padding go through getStringIndex() on their symbol codes.
+*/
+void Solver::calculatePackedOffsets(bool first, vector<int>& indices) const {
+    const PackedSequence& packed = first ? *packed_a : *packed_b;
+    int size = first ? string_a_real_size : string_b_real_size;
+    // index of the block of code 0 only, the first without blanks
+    uint8_t codes[SUBMATRIX_MAX_DIMENSION] = {0};
+    int full_offset = subm_calc->getStringIndex(codes);
+    int full_blocks = size / submatrix_dim;
+    for (int i = 1; i < (int)indices.size(); i++) {
+        int start = (i - 1) * submatrix_dim;
+        if (i <= full_blocks && !packed.hasException(start, submatrix_dim)) {
+            indices[i] = full_offset + (int)packed.codes(start, submatrix_dim);
+        } else {
+            read_codes(first, start, submatrix_dim, codes);
+            indices[i] = subm_calc->getStringIndex(codes);
+        }
     }
 }
 
+/*
+    Writes the symbol codes of positions [start, start + count) of string_a
+    (first) or string_b to codes, blanks past the end of the string. Packed
+    strings are decoded from their words and exception runs, so the solver
+    keeps no per-character copy of them.
+*/
+void Solver::read_codes(bool first, int start, int count,
+                        uint8_t* codes) const {
+    const PackedSequence* packed = first ? packed_a : packed_b;
+    int size = first ? string_a_real_size : string_b_real_size;
+    int real = max(0, min(count, size - start));
+    if (packed == NULL) {
+        const vector<uint8_t>& source = first ? codes_a : codes_b;
+        copy(source.begin() + start, source.begin() + start + real, codes);
+    } else if (!packed->hasException(start, real)) {
+        for (int k = 0; k < real; k++) codes[k] = packed->code(start + k);
+    } else {
+        for (int k = 0; k < real; k++) {
+            codes[k] = subm_calc->symbolCode(packed->at(start + k));
+        }
+    }
+    fill(codes + real, codes + count, subm_calc->symbolCode(BLANK_CHAR));
+}
+
 /*
     Calculates sequence alignments based on an edit path.
     Integers in the edit path represent:
     1 - moving down in the submatrix
     2 - moving right in the submatrix
     3 - moving diagonally in the submatrix
+    The aligned strings are returned in the order the solver was given them.
 */
 pair<string, string> Solver::calculate_alignment(vector<int> path) {
+    PhaseTimer timer(Metrics::ALIGNMENT);
+    string unpacked_a, unpacked_b;
+    if (packed_a != NULL) {
+        unpacked_a = packed_a->unpack();
+        unpacked_b = packed_b->unpack();
+    }
+    const string& string_a = packed_a != NULL ? unpacked_a : this->string_a;
+    const string& string_b = packed_b != NULL ? unpacked_b : this->string_b;
+
     string a_aligned;
     string b_aligned;
+    a_aligned.reserve(path.size());
+    b_aligned.reserve(path.size());
 
     int a_cnt = 0, b_cnt = 0;
     for (int i = path.size() - 1; i >= 0; i--) {
@@ -125,51 +316,71 @@ pair<string, string> Solver::calculate_alignment(vector<int> path) {
         }
     }
 
+    if (this->swapped) return make_pair(b_aligned, a_aligned);
     return make_pair(a_aligned, b_aligned);
 }
 
 /*
-    Backtracks through the submatrices until it reaches the
-    starting cell. Edit operations in the vector will be ordered backwards
-    and the integers represent:
+    Backtracks through the submatrices from the end cell (see find_end())
+    until it reaches the starting cell. Edit operations in the vector will
+    be ordered backwards and the integers represent:
     1 - moving down in the submatrix
     2 - moving right in the submatrix
     3 - moving diagonally in the submatrix
 */
 vector<int> Solver::get_edit_path() {
-    pair<vector<int>, pair<pair<int, int>, pair<int, int> > > ret;
+    PhaseTimer timer(Metrics::TRACEBACK);
+    SubmatrixCalculator::PathExit exit;
     vector<int> edit_path;
+    edit_path.reserve(string_a_real_size + string_b_real_size);
 
-    int x = string_a_real_size / submatrix_dim;
-    if ((string_a_real_size % submatrix_dim) != 0) x++;
-    int y = string_b_real_size / submatrix_dim;
-    if ((string_b_real_size % submatrix_dim) != 0) y++;
-    int sub_x = string_a_real_size % submatrix_dim;
-    int sub_y = string_b_real_size % submatrix_dim;
+    vector<int> right(row_num + 1);
+    for (int submatrix_i = 1; submatrix_i <= row_num; submatrix_i++) {
+        right[submatrix_i] = all_columns[submatrix_i][column_num];
+    }
+    int end_i, end_j;
+    find_end(all_rows[row_num], right, end_i, end_j);
 
-    if (sub_x == 0) sub_x = submatrix_dim;
-    if (sub_y == 0) sub_y = submatrix_dim;
+    // free trailing gaps past the end cell
+    for (int j = end_j; j < string_b_real_size; j++) edit_path.push_back(2);
+    for (int i = end_i; i < string_a_real_size; i++) edit_path.push_back(1);
 
+    int x = (end_i + submatrix_dim - 1) / submatrix_dim;
+    int y = (end_j + submatrix_dim - 1) / submatrix_dim;
+    int sub_x = end_i - (x - 1) * submatrix_dim;
+    int sub_y = end_j - (y - 1) * submatrix_dim;
+
+    long long blocks = 0;
     while (x != 0 && y != 0) {
-        ret = subm_calc->getSubmatrixPath(
-                  string_a.substr((x - 1) * submatrix_dim, submatrix_dim),
-                  string_b.substr((y - 1) * submatrix_dim, submatrix_dim),
-                  all_columns[x][y - 1], all_rows[x - 1][y], sub_x, sub_y,
-                  top_left_costs[x][y]);
-        for (unsigned int i = 0; i < ret.first.size(); i++) {
-            edit_path.push_back(ret.first[i]);
+        blocks++;
+        // a lookup in the path table where the table has one; the block the
+        // path ends in may be entered at any cell, and is traced directly
+        if (!subm_calc->getStoredPath(
+                subm_calc->getPairBase(str_a_indices[x], str_b_indices[y]),
+                all_columns[x][y - 1], all_rows[x - 1][y], sub_x, sub_y,
+                edit_path, exit)) {
+            uint8_t block_a[SUBMATRIX_MAX_DIMENSION];
+            uint8_t block_b[SUBMATRIX_MAX_DIMENSION];
+            read_codes(true, (x - 1) * submatrix_dim, submatrix_dim, block_a);
+            read_codes(false, (y - 1) * submatrix_dim, submatrix_dim, block_b);
+            subm_calc->getSubmatrixPath(block_a, block_b,
+                                        all_columns[x][y - 1],
+                                        all_rows[x - 1][y], sub_x, sub_y,
+                                        edit_path, exit);
         }
 
-        x += ret.second.first.first;
-        y += ret.second.first.second;
-        sub_x = ret.second.second.first;
-        sub_y = ret.second.second.second;
+        x += exit.matrixRow;
+        y += exit.matrixCol;
+        sub_x = exit.cellRow;
+        sub_y = exit.cellCol;
     }
+    Metrics::add(Metrics::TRACEBACK_BLOCKS, blocks);
 
     /*
         Once we have reached the submatrix in the first row (or the first column)
         of the full matrix, we may still need to move along the row (or column)
-        towards the starting cell in position 0, 0.
+        towards the starting cell in position 0, 0; free leading gaps move
+        along it at no cost.
     */
     if (x == 0) {
         for (int i = 0; i < (y - 1) * submatrix_dim + sub_y; i++) {
@@ -186,6 +397,311 @@ vector<int> Solver::get_edit_path() {
     return edit_path;
 }
 
+/*
+    Computes the edit distance and sequence alignments in O(n + m) memory,
+    at about twice the time of calculate(). Hirschberg's divide and conquer
+    over the block sweep of fill_edit_matrix_low_memory(): the costs of the
+    middle row of string_a are found by sweeping the top half forwards and
+    the bottom half backwards, the optimal path crosses that row at the
+    column minimizing their sum, and both halves are aligned recursively -
+    in parallel when more than one thread is available.
+*/
+pair<int, pair<string, string> > Solver::calculate_with_path_linear() {
+    int threads = this->threads > 0 ? this->threads
+                                    : (int)thread::hardware_concurrency();
+
+    vector<int> edit_path;
+    edit_path.reserve(string_a_real_size + string_b_real_size);
+    {
+        // the sweeps and the small alignments at the leaves count as fill
+        PhaseTimer timer(Metrics::FILL);
+        align_range(0, string_a_real_size, 0, string_b_real_size, free_ends,
+                    max(1, threads), edit_path);
+    }
+
+    // free gaps lead and trail the path along the first and last row or
+    // column
+    int first = 0, last = edit_path.size();
+    if (first < last) {
+        int op = edit_path[first];
+        if ((op == 1 && (free_ends & FREE_FIRST_START)) ||
+            (op == 2 && (free_ends & FREE_SECOND_START))) {
+            while (first < last && edit_path[first] == op) first++;
+        }
+    }
+    if (first < last) {
+        int op = edit_path[last - 1];
+        if ((op == 1 && (free_ends & FREE_FIRST_END)) ||
+            (op == 2 && (free_ends & FREE_SECOND_END))) {
+            while (first < last && edit_path[last - 1] == op) last--;
+        }
+    }
+
+    // the cost of the rest of the path is the edit distance
+    int edit_distance = 0;
+    int a_cnt = 0, b_cnt = 0;
+    for (int i = 0; i < (int)edit_path.size(); i++) {
+        bool free_gap = i < first || i >= last;
+        if (edit_path[i] == 1) {
+            if (!free_gap) edit_distance += subm_calc->getDeleteCost();
+            a_cnt++;
+        } else if (edit_path[i] == 2) {
+            if (!free_gap) edit_distance += subm_calc->getInsertCost();
+            b_cnt++;
+        } else {
+            uint8_t x, y;
+            read_codes(true, a_cnt++, 1, &x);
+            read_codes(false, b_cnt++, 1, &y);
+            edit_distance += subm_calc->getReplaceCost(x, y);
+        }
+    }
+
+    // calculate_alignment() expects the backwards order of get_edit_path()
+    reverse(edit_path.begin(), edit_path.end());
+    return make_pair(edit_distance, calculate_alignment(edit_path));
+}
+
+/*
+    Reverses the direction of the end gap flags: the backward sweep reads
+    the ends of a range as its starts and the other way round.
+*/
+static int reverse_end_gaps(int ends) {
+    int reversed = 0;
+    if (ends & Solver::FREE_FIRST_START) reversed |= Solver::FREE_FIRST_END;
+    if (ends & Solver::FREE_FIRST_END) reversed |= Solver::FREE_FIRST_START;
+    if (ends & Solver::FREE_SECOND_START) reversed |= Solver::FREE_SECOND_END;
+    if (ends & Solver::FREE_SECOND_END) reversed |= Solver::FREE_SECOND_START;
+    return reversed;
+}
+
+/*
+    Appends the edit operations of an optimal alignment of the n symbols of
+    string_a from position a with the m symbols of string_b from position b
+    to edit_path, in forward order. ends holds the free end gaps of the
+    range (see setFreeEndGaps()), with string_a as the first string.
+*/
+void Solver::align_range(int a, int n, int b, int m, int ends, int threads,
+                         vector<int>& edit_path) const {
+    if (n <= 1 || m == 0 || (long long)n * m <= LEAF_CELLS) {
+        align_leaf(a, n, b, m, ends, edit_path);
+        return;
+    }
+
+    /*
+        The middle row is neither the first nor the last one, so only free
+        gaps along the first and last column reach past it: a path may end
+        in the last column above it, or start in the first column below it.
+    */
+    int mid = n / 2;
+    int top_ends =
+        ends & (FREE_FIRST_START | FREE_SECOND_START | FREE_FIRST_END);
+    int bottom_ends = reverse_end_gaps(
+        ends & (FREE_FIRST_END | FREE_SECOND_END | FREE_FIRST_START));
+    vector<int> forward;
+    vector<int> backward;
+    if (threads > 1) {
+        thread worker([&]() {
+            PhaseTimer cpu(Metrics::FILL, false);
+            sweep_last_row(a, mid, b, m, false, top_ends, forward);
+        });
+        sweep_last_row(a + mid, n - mid, b, m, true, bottom_ends, backward);
+        worker.join();
+    } else {
+        sweep_last_row(a, mid, b, m, false, top_ends, forward);
+        sweep_last_row(a + mid, n - mid, b, m, true, bottom_ends, backward);
+    }
+
+    // the first column where the optimal path crosses the middle row
+    int split = 0;
+    for (int j = 1; j <= m; j++) {
+        if (forward[j] + backward[m - j] < forward[split] + backward[m - split]) {
+            split = j;
+        }
+    }
+    vector<int>().swap(forward);
+    vector<int>().swap(backward);
+
+    top_ends = (ends & (FREE_FIRST_START | FREE_SECOND_START)) |
+               (split == m ? ends & FREE_FIRST_END : 0);
+    bottom_ends = (ends & (FREE_FIRST_END | FREE_SECOND_END)) |
+                  (split == 0 ? ends & FREE_FIRST_START : 0);
+    if (threads > 1) {
+        vector<int> second;
+        thread worker([&]() {
+            PhaseTimer cpu(Metrics::FILL, false);
+            align_range(a + mid, n - mid, b + split, m - split, bottom_ends,
+                        threads - threads / 2, second);
+        });
+        align_range(a, mid, b, split, top_ends, threads / 2, edit_path);
+        worker.join();
+        edit_path.insert(edit_path.end(), second.begin(), second.end());
+    } else {
+        align_range(a, mid, b, split, top_ends, 1, edit_path);
+        align_range(a + mid, n - mid, b + split, m - split, bottom_ends, 1,
+                    edit_path);
+    }
+}
+
+/*
+    Fills costs[j] with the edit distance between the n symbols of string_a
+    from position a and the first j of the m symbols of string_b from
+    position b, for every j up to m, using only one row of blocks. With
+    reverse set both ranges are read backwards, so costs[j] is the distance
+    to the last j symbols of the string_b range instead. Free starts in
+    ends apply to the sweep order; with FREE_FIRST_END costs[m] is the
+    cheapest cell of the last column instead.
+*/
+void Solver::sweep_last_row(int a, int n, int b, int m, bool reverse,
+                            int ends, vector<int>& costs) const {
+    int rows = (n + submatrix_dim - 1) / submatrix_dim;
+    int columns = (m + submatrix_dim - 1) / submatrix_dim;
+    uint8_t blank = subm_calc->symbolCode(BLANK_CHAR);
+
+    // padded copies of both strings in sweep order
+    vector<uint8_t> padded_a(rows * submatrix_dim, blank);
+    vector<uint8_t> padded_b(columns * submatrix_dim, blank);
+    read_codes(true, a, n, padded_a.data());
+    read_codes(false, b, m, padded_b.data());
+    if (reverse) {
+        std::reverse(padded_a.begin(), padded_a.begin() + n);
+        std::reverse(padded_b.begin(), padded_b.begin() + m);
+    }
+
+    vector<int> b_indices(columns + 1);
+    vector<int> row(columns + 1);
+    for (int submatrix_j = 1; submatrix_j <= columns; submatrix_j++) {
+        b_indices[submatrix_j] = subm_calc->getStringIndex(
+            &padded_b[(submatrix_j - 1) * submatrix_dim]);
+        row[submatrix_j] = subm_calc->getRowBoundarySteps(
+            ends & FREE_SECOND_START
+                ? 0
+                : min(m - (submatrix_j - 1) * submatrix_dim, submatrix_dim));
+    }
+
+    // right steps of the last block column
+    vector<int> right(rows + 1);
+    for (int submatrix_i = 1; submatrix_i <= rows; submatrix_i++) {
+        int left = subm_calc->getColumnBoundarySteps(
+            ends & FREE_FIRST_START
+                ? 0
+                : min(n - (submatrix_i - 1) * submatrix_dim, submatrix_dim));
+        const unsigned int* pair_bases = subm_calc->getPairBases(
+            subm_calc->getStringIndex(
+                &padded_a[(submatrix_i - 1) * submatrix_dim]));
+
+        for (int submatrix_j = 1; submatrix_j <= columns; submatrix_j++) {
+            pair<int, int> final_steps = subm_calc->getFinalSteps(
+                pair_bases[b_indices[submatrix_j]], left, row[submatrix_j]);
+            left = final_steps.first;
+            row[submatrix_j] = final_steps.second;
+        }
+        right[submatrix_i] = left;
+    }
+    Metrics::add(Metrics::BLOCKS, (uint64_t)rows * columns);
+
+    // the bottom steps of every block, summed up from the first column
+    costs.resize(m + 1);
+    costs[0] = ends & FREE_FIRST_START ? 0 : n * subm_calc->getDeleteCost();
+    int steps[SUBMATRIX_MAX_DIMENSION];
+    for (int submatrix_j = 1; submatrix_j <= columns; submatrix_j++) {
+        subm_calc->decodeSteps(row[submatrix_j], steps);
+        for (int k = 0; k < submatrix_dim; k++) {
+            int j = (submatrix_j - 1) * submatrix_dim + k + 1;
+            if (j > m) break;
+            costs[j] = costs[j - 1] + steps[k];
+        }
+    }
+    if (!(ends & FREE_FIRST_END) || columns == 0) return;
+
+    // and the right steps, summed up from the first row
+    int cost = ends & FREE_SECOND_START ? 0 : m * subm_calc->getInsertCost();
+    costs[m] = min(costs[m], cost);
+    for (int submatrix_i = 1; submatrix_i <= rows; submatrix_i++) {
+        subm_calc->decodeSteps(right[submatrix_i], steps);
+        for (int k = 0; k < submatrix_dim; k++) {
+            int i = (submatrix_i - 1) * submatrix_dim + k + 1;
+            if (i > n) break;
+            cost += steps[k];
+            costs[m] = min(costs[m], cost);
+        }
+    }
+}
+
+/*
+    Aligns a small range with a plain edit matrix; appends its edit
+    operations to edit_path in forward order. Ties prefer moving
+    diagonally, then down, like the submatrix traceback, and ending in the
+    bottom right cell. ends are the free end gaps of the range, see
+    align_range().
+*/
+void Solver::align_leaf(int a_start, int n, int b_start, int m, int ends,
+                        vector<int>& edit_path) const {
+    vector<uint8_t> a(n), b(m);
+    read_codes(true, a_start, n, a.data());
+    read_codes(false, b_start, m, b.data());
+    int delete_cost = subm_calc->getDeleteCost();
+    int insert_cost = subm_calc->getInsertCost();
+    vector<int> matrix((n + 1) * (m + 1));
+    for (int i = 0; i <= n; i++) {
+        matrix[i * (m + 1)] = ends & FREE_FIRST_START ? 0 : i * delete_cost;
+    }
+    for (int j = 0; j <= m; j++) {
+        matrix[j] = ends & FREE_SECOND_START ? 0 : j * insert_cost;
+    }
+    for (int i = 1; i <= n; i++) {
+        for (int j = 1; j <= m; j++) {
+            int replace = matrix[(i - 1) * (m + 1) + j - 1] +
+                          subm_calc->getReplaceCost(a[i - 1], b[j - 1]);
+            int remove = matrix[(i - 1) * (m + 1) + j] + delete_cost;
+            int insert = matrix[i * (m + 1) + j - 1] + insert_cost;
+            matrix[i * (m + 1) + j] = min(replace, min(remove, insert));
+        }
+    }
+
+    int first = edit_path.size();
+    int i = n, j = m;
+    int best = matrix[n * (m + 1) + m];
+    if (ends & FREE_SECOND_END) {
+        for (int k = m - 1; k >= 0; k--) {
+            if (matrix[n * (m + 1) + k] < best) {
+                best = matrix[n * (m + 1) + k];
+                j = k;
+            }
+        }
+    }
+    if (ends & FREE_FIRST_END) {
+        for (int k = n - 1; k >= 0; k--) {
+            if (matrix[k * (m + 1) + m] < best) {
+                best = matrix[k * (m + 1) + m];
+                i = k;
+                j = m;
+            }
+        }
+    }
+    for (int k = j; k < m; k++) edit_path.push_back(2);
+    for (int k = i; k < n; k++) edit_path.push_back(1);
+
+    while (i > 0 || j > 0) {
+        int cost = matrix[i * (m + 1) + j];
+        if (i > 0 && j > 0 &&
+            cost == matrix[(i - 1) * (m + 1) + j - 1] +
+                        subm_calc->getReplaceCost(a[i - 1], b[j - 1])) {
+            edit_path.push_back(3);
+            i--;
+            j--;
+        } else if (i > 0 &&
+                   (j == 0 ||
+                    cost == matrix[(i - 1) * (m + 1) + j] + delete_cost)) {
+            edit_path.push_back(1);
+            i--;
+        } else {
+            edit_path.push_back(2);
+            j--;
+        }
+    }
+    reverse(edit_path.begin() + first, edit_path.end());
+}
+
 /*
     Computes and returns the edit distance. This function will use less
     memory than it's calculate_with_path() counterpart since it doesn't
@@ -194,14 +710,156 @@ vector<int> Solver::get_edit_path() {
 int Solver::calculate() {
     fill_edit_matrix_low_memory();
 
-    int edit_distance = string_a_real_size;
+    int end_i, end_j;
+    return find_end(final_row, final_column, end_i, end_j);
+}
+
+/*
+    Computes the edit distance if it is at most max_distance, and returns
+    max_distance + 1 otherwise. Only the blocks of the diagonal band holding
+    cells within max_distance of the main diagonal are evaluated, and the
+    calculation stops at the first block row whose cells all exceed the
+    bound, so near-identical pairs cost O(n * max_distance).
+    Values are capped at max_distance + 1: capping keeps neighbouring cells
+    within one step of each other, every cell outside the band has the
+    capped value, and a block fed capped inputs yields the capped values
+    once its outputs are capped as well. The absolute value of each block
+    corner is tracked along with the step codes to apply the cap.
+    Both the cap and the band rely on unit steps and a global alignment, so
+    other costs and free end gaps calculate the whole matrix.
+*/
+int Solver::calculate(int max_distance) {
+    int cap = max_distance + 1;
+    if (!subm_calc->hasUnitCosts() || free_ends != 0) {
+        return max_distance < 0 ? cap : min(calculate(), cap);
+    }
+    if (max_distance < 0 || string_a_real_size - string_b_real_size > max_distance) {
+        return cap;
+    }
+
+    int band = (max_distance + submatrix_dim - 1) / submatrix_dim;
+    if (2 * band + 1 >= column_num) {
+        // the band covers the whole matrix
+        return min(calculate(), cap);
+    }
+    PhaseTimer timer(Metrics::FILL);
 
+    // bottom steps and absolute bottom right value of the last block row
+    vector<int> row(column_num + 1);
+    vector<int> corner(column_num + 1);
+    corner[0] = 0;
     for (int submatrix_j = 1; submatrix_j <= column_num; submatrix_j++) {
-        edit_distance +=
-            subm_calc->sumSteps(final_rows[row_num % 2][submatrix_j]);
+        int start = min((submatrix_j - 1) * submatrix_dim, cap);
+        row[submatrix_j] =
+            cap_steps(initial_row_steps(submatrix_j), start, cap);
+        corner[submatrix_j] = start + subm_calc->sumSteps(row[submatrix_j]);
+    }
+
+    for (int submatrix_i = 1; submatrix_i <= row_num; submatrix_i++) {
+        int first_j = max(1, submatrix_i - band);
+        int last_j = min(column_num, submatrix_i + band);
+        Metrics::add(Metrics::BLOCKS, last_j - first_j + 1);
+
+        // value of the top left cell of the current block
+        int diagonal = corner[first_j - 1];
+        int left;
+        if (first_j == 1) {
+            left = cap_steps(initial_column_steps(submatrix_i), diagonal, cap);
+        } else {
+            // the block to the left is outside the band
+            left = subm_calc->getColumnBoundarySteps(diagonal < cap ? 1 : 0);
+        }
+        int bottom_left = diagonal + subm_calc->sumSteps(left);
+        int row_min = bottom_left;
+
+        const unsigned int* pair_bases =
+            subm_calc->getPairBases(str_a_indices[submatrix_i]);
+
+        for (int submatrix_j = first_j; submatrix_j <= last_j; submatrix_j++) {
+            int top = row[submatrix_j];
+            int top_right = corner[submatrix_j];
+            if (submatrix_i > 1 && submatrix_j > submatrix_i - 1 + band) {
+                // the block above is outside the band
+                top = subm_calc->getRowBoundarySteps(diagonal < cap ? 1 : 0);
+                top_right = cap;
+            }
+
+            pair<int, int> final_steps = subm_calc->getFinalSteps(
+                pair_bases[str_b_indices[submatrix_j]], left, top);
+
+            int right = final_steps.first;
+            int bottom = final_steps.second;
+            if (top_right + subm_calc->maxPartialSteps(right) > cap) {
+                right = cap_steps(right, top_right, cap);
+            }
+            if (bottom_left + subm_calc->maxPartialSteps(bottom) > cap) {
+                bottom = cap_steps(bottom, bottom_left, cap);
+            }
+            row_min = min(row_min,
+                          bottom_left + subm_calc->minPartialSteps(bottom));
+
+            diagonal = top_right;
+            left = right;
+            bottom_left += subm_calc->sumSteps(bottom);
+            row[submatrix_j] = bottom;
+            corner[submatrix_j] = bottom_left;
+        }
+        corner[0] = min(min(submatrix_i * submatrix_dim, string_a_real_size), cap);
+
+        // every path to the last row crosses this one
+        if (row_min >= cap) return cap;
     }
 
-    return edit_distance;
+    return min(corner[column_num], cap);
+}
+
+/*
+    Computes the edit distance with Ukkonen's band doubling: bounded runs of
+    calculate(max_distance) with a doubling bound until the distance fits,
+    or until the band covers the whole matrix. Costs O(n * d) for a pair at
+    distance d. Costs other than unit ones and free end gaps calculate the
+    whole matrix.
+*/
+int Solver::calculate_banded() {
+    if (!subm_calc->hasUnitCosts() || free_ends != 0) return calculate();
+    int max_distance = max(string_a_real_size - string_b_real_size, 32);
+    while (true) {
+        int band = (max_distance + submatrix_dim - 1) / submatrix_dim;
+        if (2 * band + 1 >= column_num) {
+            return calculate();
+        }
+
+        int distance = calculate(max_distance);
+        if (distance <= max_distance) {
+            return distance;
+        }
+        max_distance *= 2;
+    }
+}
+
+/*
+    Re-encodes the step code of cells starting after a cell of value start
+    so that every value is capped at cap. Only used with unit costs, whose
+    step codes are base 3, so the digits are decoded here with a constant
+    radix.
+*/
+int Solver::cap_steps(int steps, int start, int cap) const {
+    int values[SUBMATRIX_MAX_DIMENSION];
+    for (int i = submatrix_dim - 1; i >= 0; i--) {
+        values[i] = steps % 3 - 1;
+        steps /= 3;
+    }
+
+    int value = start;
+    int capped = min(start, cap);
+    int code = 0;
+    for (int i = 0; i < submatrix_dim; i++) {
+        value += values[i];
+        int next = min(value, cap);
+        code = code * 3 + next - capped + 1;
+        capped = next;
+    }
+    return code;
 }
 
 /*
@@ -212,14 +870,99 @@ int Solver::calculate() {
 pair<int, pair<string, string> > Solver::calculate_with_path() {
     fill_edit_matrix();
 
-    int edit_distance = string_a_real_size;
+    vector<int> right(row_num + 1);
+    for (int submatrix_i = 1; submatrix_i <= row_num; submatrix_i++) {
+        right[submatrix_i] = all_columns[submatrix_i][column_num];
+    }
+    int end_i, end_j;
+    int edit_distance = find_end(all_rows[row_num], right, end_i, end_j);
+
+    return make_pair(edit_distance, calculate_alignment(get_edit_path()));
+}
+
+/*
+    Step code of the first row of block column submatrix_j: the insert cost
+    for each character of string_b in the block, 0 over the padding. Free
+    leading gaps of string_b make the whole row 0.
+*/
+int Solver::initial_row_steps(int submatrix_j) const {
+    if (free_ends & FREE_SECOND_START) return subm_calc->getRowBoundarySteps(0);
+    int count = string_b_real_size - (submatrix_j - 1) * submatrix_dim;
+    return subm_calc->getRowBoundarySteps(min(count, submatrix_dim));
+}
+
+/*
+    Step code of the first column of block row submatrix_i, like
+    initial_row_steps() for string_a with the delete cost.
+*/
+int Solver::initial_column_steps(int submatrix_i) const {
+    if (free_ends & FREE_FIRST_START) {
+        return subm_calc->getColumnBoundarySteps(0);
+    }
+    int count = string_a_real_size - (submatrix_i - 1) * submatrix_dim;
+    return subm_calc->getColumnBoundarySteps(min(count, submatrix_dim));
+}
+
+/*
+    Finds the cell the optimal path ends at and returns its cost: the bottom
+    right cell, or with free trailing gaps the cheapest cell of the last row
+    (FREE_SECOND_END) or of the last column (FREE_FIRST_END). bottom holds
+    the bottom step codes of the last block row and right the right step
+    codes of the last block column, both indexed from 1; padding repeats the
+    last real row and column, so they hold the steps of those. Ties go to
+    the bottom right cell, then to the cells closest to it.
+*/
+int Solver::find_end(const vector<int>& bottom, const vector<int>& right,
+                     int& end_i, int& end_j) const {
+    int steps[SUBMATRIX_MAX_DIMENSION];
+    bool free_row = free_ends & FREE_SECOND_END;
+    bool free_column = free_ends & FREE_FIRST_END;
 
+    // along the last row from its first cell
+    int cost = free_ends & FREE_FIRST_START
+                   ? 0
+                   : string_a_real_size * subm_calc->getDeleteCost();
+    int best = cost;
+    end_j = 0;
     for (int submatrix_j = 1; submatrix_j <= column_num; submatrix_j++) {
-        edit_distance +=
-            subm_calc->sumSteps(all_rows[row_num][submatrix_j]);
+        subm_calc->decodeSteps(bottom[submatrix_j], steps);
+        for (int k = 0; k < submatrix_dim; k++) {
+            int j = (submatrix_j - 1) * submatrix_dim + k + 1;
+            if (j > string_b_real_size) break;
+            cost += steps[k];
+            if (!free_row || cost <= best) {
+                best = cost;
+                end_j = j;
+            }
+        }
     }
+    end_i = string_a_real_size;
+    if (!free_column) return best;
 
-    return make_pair(edit_distance, calculate_alignment(get_edit_path()));
+    // down the last column from its first cell
+    cost = free_ends & FREE_SECOND_START
+               ? 0
+               : string_b_real_size * subm_calc->getInsertCost();
+    int column_best = cost;
+    int column_i = 0;
+    for (int submatrix_i = 1; submatrix_i <= row_num; submatrix_i++) {
+        subm_calc->decodeSteps(right[submatrix_i], steps);
+        for (int k = 0; k < submatrix_dim; k++) {
+            int i = (submatrix_i - 1) * submatrix_dim + k + 1;
+            if (i > string_a_real_size) break;
+            cost += steps[k];
+            if (cost <= column_best) {
+                column_best = cost;
+                column_i = i;
+            }
+        }
+    }
+    if (column_best < best) {
+        best = column_best;
+        end_i = column_i;
+        end_j = string_b_real_size;
+    }
+    return best;
 }
 
 /*
@@ -228,132 +971,171 @@ pair<int, pair<string, string> > Solver::calculate_with_path() {
     each submatrix in memory.
 */
 void Solver::fill_edit_matrix() {
+    PhaseTimer timer(Metrics::FILL);
+    Metrics::add(Metrics::BLOCKS, (uint64_t)row_num * column_num);
     all_columns.resize(row_num + 1, vector<int>(column_num + 1, 0));
     all_rows.resize(row_num + 1, vector<int>(column_num + 1, 0));
-    top_left_costs.resize(row_num + 1, vector<int>(column_num + 1, 0));
-
-    int initialVector = 0;
-    for (int i = 0; i < submatrix_dim; i++){
-        initialVector = initialVector * 10 + 2; // 222 == "222" == (1, 1, 1)
-    }
 
     // padding string b step vectors
     for (int submatrix_j = 1; submatrix_j <= column_num; submatrix_j++) {
-        if ((submatrix_j * submatrix_dim - 1) >= string_b_real_size) {
-            vector<int> temp_vec(submatrix_dim, 0);
-            for (int i = 0;
-                    i < (string_b_real_size - ((submatrix_j - 1) * submatrix_dim));
-                    i++)
-                temp_vec[i] = 1;
-            all_rows[0][submatrix_j] = SubmatrixCalculator::stepsToInt(temp_vec);
-        } else {
-            all_rows[0][submatrix_j] = initialVector;
-        }
+        all_rows[0][submatrix_j] = initial_row_steps(submatrix_j);
     }
 
     // padding string a step vectors
     for (int submatrix_i = 1; submatrix_i <= row_num; submatrix_i++) {
-        if ((submatrix_i * submatrix_dim - 1) >= string_a_real_size) {
-            vector<int> temp_vec(submatrix_dim, 0);
-            for (int i = 0;
-                    i < (string_a_real_size - ((submatrix_i - 1) * submatrix_dim));
-                    i++)
-                temp_vec[i] = 1;
-            all_columns[submatrix_i][0] =
-                SubmatrixCalculator::stepsToInt(temp_vec);
-        } else {
-            all_columns[submatrix_i][0] = initialVector;
-        }
+        all_columns[submatrix_i][0] = initial_column_steps(submatrix_i);
     }
 
-    for (int submatrix_i = 1; submatrix_i <= row_num; submatrix_i++) {
-        if ((submatrix_i - 1) * submatrix_dim > string_a_real_size)
-            top_left_costs[submatrix_i][1] = string_a_real_size;
-        else
-            top_left_costs[submatrix_i][1] = (submatrix_i - 1) * submatrix_dim;
-
-        for (int submatrix_j = 1; submatrix_j <= column_num; submatrix_j++) {
-
-            pair<int, int> final_steps = subm_calc->resultIndex[
-                // offset calculation
-                str_a_offsets[submatrix_i] +                                // left string
-                str_b_offsets[submatrix_j] +                                // top string
-                // left steps
-                subm_calc->stepOffsets[0][all_columns[submatrix_i][submatrix_j - 1]] +
-                // top steps
-                subm_calc->stepOffsets[1][all_rows[submatrix_i - 1][submatrix_j]]
-            ];
-
-            all_columns[submatrix_i][submatrix_j] = final_steps.first;
-            all_rows[submatrix_i][submatrix_j] = final_steps.second;
-
-            if (submatrix_j != 1) {
-                top_left_costs[submatrix_i][submatrix_j] =
-                    top_left_costs[submatrix_i][submatrix_j - 1];
-                top_left_costs[submatrix_i][submatrix_j] += subm_calc->sumSteps(
-                    all_rows[submatrix_i - 1][submatrix_j - 1]);
+    run_wavefront([this](int tile_row, int first_i, int last_i, int first_j,
+                         int last_j) {
+        (void)tile_row;
+        for (int submatrix_i = first_i; submatrix_i <= last_i; submatrix_i++) {
+            const unsigned int* pair_bases =
+                subm_calc->getPairBases(str_a_indices[submatrix_i]);
+
+            for (int submatrix_j = first_j; submatrix_j <= last_j;
+                    submatrix_j++) {
+
+                pair<int, int> final_steps = subm_calc->getFinalSteps(
+                    pair_bases[str_b_indices[submatrix_j]],     // left and top strings
+                    all_columns[submatrix_i][submatrix_j - 1],  // left steps
+                    all_rows[submatrix_i - 1][submatrix_j]);    // top steps
+
+                all_columns[submatrix_i][submatrix_j] = final_steps.first;
+                all_rows[submatrix_i][submatrix_j] = final_steps.second;
             }
         }
-    }
+    });
 }
 
 /*
     Uses the precalculated submatrices from SubmatrixCalculator to determine
-    the values in the edit matrix. Only the two columns and rows that were
-    last retrieved are kept in memory.
+    the values in the edit matrix. Only one row of block bottoms is kept in
+    memory, overwritten in place block row by block row, plus the right
+    columns of the tile rows in flight and of the last block column.
 */
 void Solver::fill_edit_matrix_low_memory() {
-    for (int i = 0; i < 2; i++) {
-        final_rows[i].resize(column_num + 1);
-    }
-
-    int initialVector = 0;
-    for (int i = 0; i < submatrix_dim; i++){
-        initialVector = initialVector * 10 + 2; // 222 == "222" == (1, 1, 1)
-    }
+    PhaseTimer timer(Metrics::FILL);
+    Metrics::add(Metrics::BLOCKS, (uint64_t)row_num * column_num);
+    vector<int>& row = final_row;
+    row.resize(column_num + 1);
+    final_column.resize(row_num + 1);
 
     // padding string b step vectors
     for (int submatrix_j = 1; submatrix_j <= column_num; submatrix_j++) {
-        if ((submatrix_j * submatrix_dim - 1) >= string_b_real_size) {
-            vector<int> temp_vec(submatrix_dim, 0);
-            for (int i = 0; i < (string_b_real_size - ((submatrix_j - 1) * submatrix_dim));
-                i++)
-                temp_vec[i] = 1;
-            final_rows[0][submatrix_j] = SubmatrixCalculator::stepsToInt(temp_vec);
-        } else {
-            final_rows[0][submatrix_j] = initialVector;
-        }
+        row[submatrix_j] = initial_row_steps(submatrix_j);
+    }
+    // the first column is the last one when string b is empty
+    for (int submatrix_i = 1; submatrix_i <= row_num; submatrix_i++) {
+        final_column[submatrix_i] = initial_column_steps(submatrix_i);
     }
 
-    for (int submatrix_i = 1, alti = 1; submatrix_i <= row_num;
-            submatrix_i++, alti = !alti) {
-        if(submatrix_i % 30000 == 0) cout << submatrix_i << endl;
-        // padding string a step vectors
-        if ((submatrix_i * submatrix_dim - 1) >= string_a_real_size) {
-            vector<int> temp_vec(submatrix_dim, 0);
-            for (int i = 0; i < (string_a_real_size - ((submatrix_i - 1) * submatrix_dim));
-                    i++)
-                temp_vec[i] = 1;
-            final_columns[0] = SubmatrixCalculator::stepsToInt(temp_vec);
-        } else {
-            final_columns[0] = initialVector;
+    // the right column of every block row of a tile row, carried from one
+    // tile to the next; tile rows in flight use distinct slots of the ring
+    int slots = wavefront_threads();
+    vector<int> right_columns(slots * TILE_ROWS);
+
+    run_wavefront([&](int tile_row, int first_i, int last_i, int first_j,
+                      int last_j) {
+        int* right = &right_columns[(tile_row % slots) * TILE_ROWS];
+
+        for (int submatrix_i = first_i; submatrix_i <= last_i; submatrix_i++) {
+            // padding string a step vectors
+            int left = first_j == 1 ? initial_column_steps(submatrix_i)
+                                    : right[submatrix_i - first_i];
+
+            const unsigned int* pair_bases =
+                subm_calc->getPairBases(str_a_indices[submatrix_i]);
+
+            for (int submatrix_j = first_j; submatrix_j <= last_j;
+                    submatrix_j++) {
+
+                pair<int, int> final_steps = subm_calc->getFinalSteps(
+                    pair_bases[str_b_indices[submatrix_j]],  // left and top strings
+                    left,                                    // left steps
+                    row[submatrix_j]);                       // top steps
+
+                left = final_steps.first;
+                row[submatrix_j] = final_steps.second;
+            }
+
+            right[submatrix_i - first_i] = left;
+            if (last_j == column_num) final_column[submatrix_i] = left;
         }
+    });
+}
+
+/*
+    Number of threads the block fill runs on; a single thread when the edit
+    matrix has too few tiles to share.
+*/
+int Solver::wavefront_threads() const {
+    int threads = this->threads > 0 ? this->threads
+                                    : (int)thread::hardware_concurrency();
+    int tile_rows = (row_num + TILE_ROWS - 1) / TILE_ROWS;
+    int tile_columns = (column_num + TILE_COLUMNS - 1) / TILE_COLUMNS;
+    if (tile_rows < 2 || tile_columns < 2) return 1;
+    return max(1, min(threads, tile_rows));
+}
+
+/*
+    Calls fill_tile(tile_row, first_i, last_i, first_j, last_j) for every
+    tile of TILE_ROWS x TILE_COLUMNS blocks of the edit matrix, in an order
+    where the tiles above and to the left of a tile are always filled
+    first. Every block only depends on its left and top neighbours, so tiles
+    on the same anti-diagonal are filled in parallel.
+    Threads claim whole tile rows in order and fill them left to right; a
+    progress counter per tile row tells the thread below how far it may go.
+    A thread only claims a new tile row after finishing its last one, and
+    a tile row cannot finish before the one above it, so at most
+    wavefront_threads() consecutive tile rows are ever in flight.
+*/
+void Solver::run_wavefront(
+    const function<void(int, int, int, int, int)>& fill_tile) {
+    int tile_rows = (row_num + TILE_ROWS - 1) / TILE_ROWS;
+    int tile_columns = (column_num + TILE_COLUMNS - 1) / TILE_COLUMNS;
+    int threads = wavefront_threads();
+
+    // completed tiles of every tile row
+    atomic<int>* progress = new atomic<int>[tile_rows];
+    for (int i = 0; i < tile_rows; i++) progress[i] = 0;
+    atomic<int> next_row(0);
+
+    auto worker = [&]() {
+        for (int tile_i = next_row++; tile_i < tile_rows; tile_i = next_row++) {
+            int first_i = tile_i * TILE_ROWS + 1;
+            int last_i = min(first_i + TILE_ROWS - 1, row_num);
 
-        for (int submatrix_j = 1, altj = 1; submatrix_j <= column_num;
-                submatrix_j++, altj = !altj) {
+            for (int tile_j = 0; tile_j < tile_columns; tile_j++) {
+                if (tile_i > 0) {
+                    while (progress[tile_i - 1].load(memory_order_acquire) <=
+                           tile_j) {
+                        this_thread::yield();
+                    }
+                }
 
-            pair<int, int> final_steps = subm_calc->resultIndex[
-                // offset calculation
-                str_a_offsets[submatrix_i] +                                // left string
-                str_b_offsets[submatrix_j] +                                // top string
-                subm_calc->stepOffsets[0][final_columns[!altj]] +           // left steps
-                subm_calc->stepOffsets[1][final_rows[!alti][submatrix_j]]   // top steps
-            ];
+                int first_j = tile_j * TILE_COLUMNS + 1;
+                int last_j = min(first_j + TILE_COLUMNS - 1, column_num);
+                fill_tile(tile_i, first_i, last_i, first_j, last_j);
 
-            final_columns[altj] = final_steps.first;
-            final_rows[alti][submatrix_j] = final_steps.second;
+                progress[tile_i].store(tile_j + 1, memory_order_release);
+            }
         }
+    };
+
+    vector<thread> workers;
+    for (int i = 1; i < threads; i++) {
+        workers.push_back(thread([&worker]() {
+            PhaseTimer cpu(Metrics::FILL, false);
+            worker();
+        }));
     }
+    worker();
+    for (unsigned int i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+
+    delete[] progress;
 }
 
 /*
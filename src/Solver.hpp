@@ -5,34 +5,121 @@
 #include <iostream>
 #include <vector>
 #include <cmath>
+#include <atomic>
+#include <functional>
+#include <thread>
 
+#include "Metrics.hpp"
+#include "PackedSequence.hpp"
 #include "SubmatrixCalculator.hpp"
+#include "SubmatrixRegistry.hpp"
 
 using namespace std;
 
 class Solver {
  public:
-  Solver(string str_a, string str_b, string _alphabet = "ATGC",
-         int _submatrix_dim = 0);
+  /*
+   Free end gaps: leading or trailing characters of the first or the second
+   string that may be left unaligned at no cost, e.g. both ends of a
+   reference a read is mapped into, or the start of one read and the end of
+   another for overlaps. Combine them with |; without any the alignment is
+   global.
+  */
+  enum EndGaps {
+    FREE_FIRST_START = 1,
+    FREE_FIRST_END = 2,
+    FREE_SECOND_START = 4,
+    FREE_SECOND_END = 8
+  };
+
+  Solver(const string& str_a, const string& str_b,
+         string _alphabet = "ATGC", int _submatrix_dim = 0,
+         const EditCosts& costs = EditCosts());
+  // constructs a solver that uses an already calculated submatrix table
+  Solver(const string& str_a, const string& str_b,
+         const SubmatrixCalculator* table);
+  // constructs a solver over packed sequences, using their alphabet; both
+  // have to outlive the solver
+  Solver(const PackedSequence& str_a, const PackedSequence& str_b,
+         int _submatrix_dim = 0, const EditCosts& costs = EditCosts());
+
+  // re-targets the solver to a new pair of strings, keeping the current table
+  void reset(const string& str_a, const string& str_b);
+  // the same for packed sequences, which have to outlive the solver
+  void reset(const PackedSequence& str_a, const PackedSequence& str_b);
+
+  // number of threads filling the edit matrix; 0 uses every core
+  void setThreads(int threads);
+  // the free end gaps, see EndGaps; 0 by default
+  void setFreeEndGaps(int end_gaps);
+
+  // the submatrix dimension used when none is given, based on the length of
+  // the longer string and on the step range of the costs
+  static int chooseDimension(int longer_size, const string& alphabet,
+                             const EditCosts& costs = EditCosts());
+
+  // the aligned strings, in the order they were given
   pair<string, string> calculate_alignment(vector<int> edit_path);
   vector<int> get_edit_path();
   int calculate();
+  // the edit distance if at most max_distance, max_distance + 1 otherwise
+  int calculate(int max_distance);
+  // calculate() by band doubling; fast for pairs at a small distance
+  int calculate_banded();
   pair<int, pair<string, string> > calculate_with_path();
+  // calculate_with_path() in memory linear in the string lengths
+  pair<int, pair<string, string> > calculate_with_path_linear();
 
  private:
-  SubmatrixCalculator* subm_calc;
+  // shared read-only table; owned by SubmatrixRegistry or the caller
+  const SubmatrixCalculator* subm_calc;
 
   const char BLANK_CHAR = '-';
 
+  // blocks per tile of the parallel fill
+  static const int TILE_ROWS = 64;
+  static const int TILE_COLUMNS = 256;
+  // largest range calculate_with_path_linear() aligns without splitting
+  static const int LEAF_CELLS = 1 << 16;
+
   void fill_edit_matrix();
   void fill_edit_matrix_low_memory();
+  void prepare();
   void calculateStringOffsets();
+  void calculatePackedOffsets(bool first, vector<int>& indices) const;
+  void read_codes(bool first, int start, int count, uint8_t* codes) const;
+  int initial_row_steps(int submatrix_j) const;
+  int initial_column_steps(int submatrix_i) const;
+  int find_end(const vector<int>& bottom, const vector<int>& right,
+               int& end_i, int& end_j) const;
+  int wavefront_threads() const;
+  int cap_steps(int steps, int start, int cap) const;
+  void run_wavefront(
+      const function<void(int, int, int, int, int)>& fill_tile);
+  void align_range(int a, int n, int b, int m, int ends, int threads,
+                   vector<int>& edit_path) const;
+  void sweep_last_row(int a, int n, int b, int m, bool reverse, int ends,
+                      vector<int>& costs) const;
+  void align_leaf(int a, int n, int b, int m, int ends,
+                  vector<int>& edit_path) const;
 
-  vector<int> final_rows[2];
-  int final_columns[2];
+  // bottom steps of the last block row and right steps of the last block
+  // column, see fill_edit_matrix_low_memory()
+  vector<int> final_row;
+  vector<int> final_column;
 
   string alphabet;
+  // the strings, or empty when the solver works on packed_a and packed_b
   string string_a, string_b;
+  const PackedSequence* packed_a;
+  const PackedSequence* packed_b;
+
+  // whether string_a is the second string given; only symmetric costs
+  // allow swapping
+  bool swapped;
+  // the free end gaps as given, and with FIRST meaning string_a
+  int end_gaps;
+  int free_ends;
 
   int string_a_real_size;
   int string_b_real_size;
@@ -40,13 +127,17 @@ class Solver {
   vector<vector<int> > all_columns;
   vector<vector<int> > all_rows;
 
-  vector<int> str_a_offsets;
-  vector<int> str_b_offsets;
+  // table string index of every block of string_a and string_b
+  vector<int> str_a_indices;
+  vector<int> str_b_indices;
 
-  // value of the top left cell for each submatrix
-  vector<vector<int> > top_left_costs;
+  // table symbol codes of the padded string_a and string_b; empty for
+  // packed strings, see read_codes()
+  vector<uint8_t> codes_a;
+  vector<uint8_t> codes_b;
 
   int submatrix_dim;
+  int threads;
   int row_num;
   int column_num;
 };
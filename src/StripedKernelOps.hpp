@@ -0,0 +1,124 @@
+#ifndef STRIPEDKERNELOPS_HPP
+#define STRIPEDKERNELOPS_HPP
+
+#include <stdint.h>
+
+/*
+Vector operations of the striped kernels (see BasicEditDistanceKernel.hpp,
+AffineEditDistanceKernel.hpp and LocalAlignmentKernel.hpp), one struct per
+instruction set and score width. Additions saturate at INF and subtractions
+at 0. Only kernel translation units include this header; each section is
+compiled only when the unit is built for its instruction set.
+*/
+
+#ifdef __SSE4_2__
+#include <nmmintrin.h>
+
+// eight unsigned 16-bit scores, saturating at INF
+struct Sse42Narrow {
+  typedef __m128i V;
+  typedef uint16_t Score;
+  static const int LANES = 8;
+  static const int INF = 0xFFFF;
+
+  static inline V set1(int x) { return _mm_set1_epi16((short)x); }
+  static inline V load(const Score* p) { return _mm_loadu_si128((const V*)p); }
+  static inline void store(Score* p, V v) { _mm_storeu_si128((V*)p, v); }
+  static inline V adds(V a, V b) { return _mm_adds_epu16(a, b); }
+  static inline V subs(V a, V b) { return _mm_subs_epu16(a, b); }
+  static inline V min(V a, V b) { return _mm_min_epu16(a, b); }
+  static inline V max(V a, V b) { return _mm_max_epu16(a, b); }
+  static inline V shiftIn(V v, int x) {
+    return _mm_insert_epi16(_mm_slli_si128(v, 2), x, 0);
+  }
+  static inline bool anyLess(V a, V b) {
+    return _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_min_epu16(a, b), b)) != 0xFFFF;
+  }
+};
+
+// four 32-bit scores; INF plus any cost still fits, so additions need no
+// saturation
+struct Sse42Wide {
+  typedef __m128i V;
+  typedef int32_t Score;
+  static const int LANES = 4;
+  static const int INF = 0x3FFFFFFF;
+
+  static inline V set1(int x) { return _mm_set1_epi32(x); }
+  static inline V load(const Score* p) { return _mm_loadu_si128((const V*)p); }
+  static inline void store(Score* p, V v) { _mm_storeu_si128((V*)p, v); }
+  static inline V adds(V a, V b) { return _mm_add_epi32(a, b); }
+  static inline V subs(V a, V b) {
+    return _mm_max_epi32(_mm_sub_epi32(a, b), _mm_setzero_si128());
+  }
+  static inline V min(V a, V b) { return _mm_min_epi32(a, b); }
+  static inline V max(V a, V b) { return _mm_max_epi32(a, b); }
+  static inline V shiftIn(V v, int x) {
+    return _mm_insert_epi32(_mm_slli_si128(v, 4), x, 0);
+  }
+  static inline bool anyLess(V a, V b) {
+    return _mm_movemask_epi8(_mm_cmplt_epi32(a, b)) != 0;
+  }
+};
+#endif
+
+#ifdef __AVX2__
+#include <immintrin.h>
+
+// sixteen unsigned 16-bit scores, saturating at INF
+struct Avx2Narrow {
+  typedef __m256i V;
+  typedef uint16_t Score;
+  static const int LANES = 16;
+  static const int INF = 0xFFFF;
+
+  static inline V set1(int x) { return _mm256_set1_epi16((short)x); }
+  static inline V load(const Score* p) {
+    return _mm256_loadu_si256((const V*)p);
+  }
+  static inline void store(Score* p, V v) { _mm256_storeu_si256((V*)p, v); }
+  static inline V adds(V a, V b) { return _mm256_adds_epu16(a, b); }
+  static inline V subs(V a, V b) { return _mm256_subs_epu16(a, b); }
+  static inline V min(V a, V b) { return _mm256_min_epu16(a, b); }
+  static inline V max(V a, V b) { return _mm256_max_epu16(a, b); }
+  static inline V shiftIn(V v, int x) {
+    // the low half moves into the high one across the 128-bit boundary
+    V low = _mm256_permute2x128_si256(v, v, 0x08);
+    return _mm256_insert_epi16(_mm256_alignr_epi8(v, low, 14), (short)x, 0);
+  }
+  static inline bool anyLess(V a, V b) {
+    return _mm256_movemask_epi8(
+               _mm256_cmpeq_epi16(_mm256_min_epu16(a, b), b)) != -1;
+  }
+};
+
+// eight 32-bit scores; INF plus any cost still fits, so additions need no
+// saturation
+struct Avx2Wide {
+  typedef __m256i V;
+  typedef int32_t Score;
+  static const int LANES = 8;
+  static const int INF = 0x3FFFFFFF;
+
+  static inline V set1(int x) { return _mm256_set1_epi32(x); }
+  static inline V load(const Score* p) {
+    return _mm256_loadu_si256((const V*)p);
+  }
+  static inline void store(Score* p, V v) { _mm256_storeu_si256((V*)p, v); }
+  static inline V adds(V a, V b) { return _mm256_add_epi32(a, b); }
+  static inline V subs(V a, V b) {
+    return _mm256_max_epi32(_mm256_sub_epi32(a, b), _mm256_setzero_si256());
+  }
+  static inline V min(V a, V b) { return _mm256_min_epi32(a, b); }
+  static inline V max(V a, V b) { return _mm256_max_epi32(a, b); }
+  static inline V shiftIn(V v, int x) {
+    V low = _mm256_permute2x128_si256(v, v, 0x08);
+    return _mm256_insert_epi32(_mm256_alignr_epi8(v, low, 12), x, 0);
+  }
+  static inline bool anyLess(V a, V b) {
+    return _mm256_movemask_epi8(_mm256_cmpgt_epi32(b, a)) != 0;
+  }
+};
+#endif
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef STRIPEDSCRATCH_HPP
+#define STRIPEDSCRATCH_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+// most lanes of any striped kernel: AVX2 over 16-bit scores
+#define STRIPED_MAX_LANES 16
+// the profile index at the start of the scratch memory, an int per code
+#define STRIPED_INDEX_BYTES (256 * sizeof(int))
+
+/*
+Bytes of scratch memory a striped kernel needs for rows rows of the first
+string against the codes of second: the profile index, one profile per
+distinct code of second, and buffers more striped columns, all at the
+widest lane count and score width. The callers allocate it in their own
+translation units and pass it to the kernel as raw memory, so the kernel
+units, built for their own instruction sets, instantiate no library
+templates that the linker could pick in place of the baseline copies.
+*/
+static inline size_t stripedScratchSize(int rows, const uint8_t* second,
+                                        int columns, int buffers) {
+  bool used[256] = {false};
+  size_t profiles = 0;
+  for (int j = 0; j < columns; j++) {
+    if (!used[second[j]]) {
+      used[second[j]] = true;
+      profiles++;
+    }
+  }
+  size_t padded = (size_t)(rows + STRIPED_MAX_LANES - 1) / STRIPED_MAX_LANES *
+                  STRIPED_MAX_LANES;
+  return STRIPED_INDEX_BYTES + padded * (profiles + buffers) * sizeof(int32_t);
+}
+
+#endif
@@ -3,8 +3,8 @@ Used to calculate the m-dimension submatrices used in the Four Russians
 algorithm.
 Each submatrix is calculated like a Wagner-Fischer edit matrix with cells as
 follows:
-- (i-1, j-1) to (i, j) with 0 cost added if the characters at (i, j) match,
-replaceCost otherwise
+- (i-1, j-1) to (i, j) with the cost of replacing the left character by the
+top one added (0 for matching characters by default)
 - (i-1, j) to (i, j) with deleteCost added
 - (i, j-1) to (i, j) with insertCost added
 
@@ -17,111 +17,603 @@ Four Russians algorithm.
 
 #include "SubmatrixCalculator.hpp"
 
-SubmatrixCalculator::SubmatrixCalculator() {}
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SubmatrixCalculator::SubmatrixCalculator()
+    : resultIndex(NULL), resultSize(0), mappedData(NULL), mappedSize(0),
+      lazyStore(NULL), lazyShift(0), pathCells(0) {}
 SubmatrixCalculator::~SubmatrixCalculator() {
-    delete this->resultIndex;
+    if (this->mappedData != NULL) {
+        munmap(this->mappedData, this->mappedSize);
+    } else {
+        delete[] this->resultIndex;
+    }
+    delete[] this->lazyStore;
 }
 
 SubmatrixCalculator::SubmatrixCalculator(int _dimension, string _alphabet,
                                          char _blankCharacter, int _replaceCost,
-                                         int _deleteCost, int _insertCost) {
+                                         int _deleteCost, int _insertCost)
+    : SubmatrixCalculator(_dimension, _alphabet, _blankCharacter,
+                          EditCosts(_replaceCost, _deleteCost, _insertCost)) {}
+
+SubmatrixCalculator::SubmatrixCalculator(int _dimension, string _alphabet,
+                                         char _blankCharacter,
+                                         const EditCosts& _costs)
+    : resultIndex(NULL), resultSize(0), mappedData(NULL), mappedSize(0),
+      lazyStore(NULL), lazyShift(0), pathCells(0) {
   this->dimension = _dimension;
   this->alphabet = _alphabet;
   this->blankCharacter = _blankCharacter;
-  this->replaceCost = _replaceCost;
-  this->deleteCost = _deleteCost;
-  this->insertCost = _insertCost;
+  this->costs = _costs;
 
   // map the provided alphabet to indices to simplify addressing
+  memset(this->symbolCodes, 0, sizeof(this->symbolCodes));
   for (unsigned int i = 0; i < this->alphabet.size(); i++){
-    this->alphabetMap[this->alphabet[i]] = i;
+    this->symbolCodes[(unsigned char)this->alphabet[i]] = i;
+  }
+  this->symbolCodes[(unsigned char)this->blankCharacter] = this->alphabet.size();
+
+  int size = this->alphabet.size();
+  if (!this->costs.isValid() ||
+      (!this->costs.replaceCosts.empty() &&
+       (int)this->costs.replaceCosts.size() != size * size)) {
+    cout << "Invalid edit costs for alphabet " << this->alphabet << endl;
+    exit(1);
+  }
+  this->replaceTable.resize(size * size);
+  for (int x = 0; x < size; x++) {
+    for (int y = 0; y < size; y++) {
+      this->replaceTable[x * size + y] = this->costs.replace(x, y, size);
+    }
+  }
+  this->unitCosts = this->costs.isUnit();
+
+  calculateIndexing();
+}
+
+/*
+    Sets up the string and step numbering and the pair bases used to address
+    the table. Independent of the table contents, so it runs for both
+    calculated and loaded tables.
+*/
+void SubmatrixCalculator::calculateIndexing() {
+  if (this->dimension < 1 || this->dimension > SUBMATRIX_MAX_DIMENSION) {
+    cout << "Unsupported submatrix dimension " << this->dimension << endl;
+    exit(1);
+  }
+  if (this->dimension > maxDimension(this->costs)) {
+    cout << "Unsupported submatrix dimension " << this->dimension
+         << " for these costs" << endl;
+    exit(1);
+  }
+
+  // strings with k alphabet characters follow the ones with k + 1 characters
+  long long alphabetSize = this->alphabet.size();
+  long long power = 1;
+  for (int k = 0; k < this->dimension; k++) power *= alphabetSize;
+  this->stringOffsets.assign(this->dimension + 1, 0);
+  for (int k = this->dimension - 1; k >= 0; k--) {
+    this->stringOffsets[k] = this->stringOffsets[k + 1] + power;
+    power /= alphabetSize;
+  }
+  this->stringCount = this->stringOffsets[0] + 1;
+
+  this->stepOffset = max(this->costs.deleteCost, this->costs.insertCost);
+  this->stepBase = 2 * this->stepOffset + 1;
+  this->stepCount = 1;
+  for (int i = 0; i < this->dimension; i++) this->stepCount *= this->stepBase;
+
+  this->stepSums.resize(this->stepCount);
+  this->stepMaxima.resize(this->stepCount);
+  this->stepMinima.resize(this->stepCount);
+  for (int i = 0; i < this->stepCount; i++) {
+    int steps[SUBMATRIX_MAX_DIMENSION];
+    decodeSteps(i, steps);
+    this->stepSums[i] = accumulate(steps, steps + this->dimension, 0);
+
+    int sum = 0;
+    this->stepMaxima[i] = -this->dimension * this->stepOffset;
+    this->stepMinima[i] = this->dimension * this->stepOffset;
+    for (int j = 0; j < this->dimension; j++) {
+      sum += steps[j];
+      this->stepMaxima[i] = max(this->stepMaxima[i], sum);
+      this->stepMinima[i] = min(this->stepMinima[i], sum);
+    }
+  }
+
+  // boundary step vectors: count steps of the insert (first row) or delete
+  // (first column) cost followed by padding steps of 0
+  this->rowBoundarySteps.resize(this->dimension + 1);
+  this->columnBoundarySteps.resize(this->dimension + 1);
+  for (int count = 0; count <= this->dimension; count++) {
+    int row = 0, column = 0;
+    for (int i = 0; i < this->dimension; i++) {
+      row = row * this->stepBase + this->stepOffset +
+            (i < count ? this->costs.insertCost : 0);
+      column = column * this->stepBase + this->stepOffset +
+               (i < count ? this->costs.deleteCost : 0);
+    }
+    this->rowBoundarySteps[count] = row;
+    this->columnBoundarySteps[count] = column;
+  }
+
+  // transposing a submatrix swaps the roles of inserting and deleting and
+  // transposes the substitution matrix
+  this->symmetric = this->costs.isSymmetric();
+
+  long long count = this->stringCount;
+  long long pairCount = this->symmetric ? count * (count + 1) / 2 : count * count;
+  long long entriesPerPair = (long long)this->stepCount * this->stepCount;
+  this->resultSize = pairCount * entriesPerPair;
+
+  calculatePairBases();
+}
+
+/*
+    Fills pairBases for the current mode. A materialized table stores the
+    entry offset of each pair; a lazy one stores the (first, second) string
+    pair itself, so a missing entry can be calculated from the base alone.
+*/
+void SubmatrixCalculator::calculatePairBases() {
+  long long count = this->stringCount;
+  long long entriesPerPair = (long long)this->stepCount * this->stepCount;
+  if (this->lazyStore == NULL && !tableFits()) {
+    // too large to materialize; only the lazy mode can address it
+    this->pairBases.clear();
+    return;
+  }
+
+  this->pairBases.resize(count * count);
+  for (long long left = 0; left < count; left++) {
+    for (long long top = 0; top < count; top++) {
+      bool swapped = this->symmetric && left > top;
+      long long first = swapped ? top : left;
+      long long second = swapped ? left : top;
+      long long base;
+      if (this->lazyStore != NULL) {
+        base = first * count + second;
+      } else {
+        long long pairIndex = this->symmetric
+                                  ? first * count - first * (first - 1) / 2 + (second - first)
+                                  : first * count + second;
+        base = pairIndex * entriesPerPair;
+      }
+      this->pairBases[left * count + top] = (base << 1) | (swapped ? 1 : 0);
+    }
+  }
+}
+
+/*
+    Every step code of a dimension has to fit in the byte an entry holds for
+    it, so the dimension shrinks as the step range widens with the costs.
+*/
+int SubmatrixCalculator::maxDimension(const EditCosts& costs) {
+  int base = 2 * max(costs.deleteCost, costs.insertCost) + 1;
+  int dimension = 0;
+  for (long long count = base; count <= 256 &&
+       dimension < SUBMATRIX_MAX_DIMENSION; count *= base) {
+    dimension++;
+  }
+  return dimension;
+}
+
+/*
+    Whether the whole table is small enough to calculate up front; the limit
+    also keeps it addressable by the 32-bit pair bases.
+*/
+bool SubmatrixCalculator::tableFits() const {
+  return this->resultSize * 2 <= SUBMATRIX_MAX_TABLE_BYTES;
+}
+
+/*
+    Returns the index of a string of dimension symbol codes; strings with k
+    alphabet characters start at stringOffsets[k].
+*/
+int SubmatrixCalculator::getStringIndex(const uint8_t* codes) const {
+  int blank = this->alphabet.size();
+  int characters = 0;
+  while (characters < this->dimension && codes[characters] != blank) {
+    characters++;
   }
-  this->alphabetMap[this->blankCharacter] = this->alphabet.size();
 
-  this->initialSteps.reserve(pow(3, _dimension));
-  this->initialStrings.reserve(pow(_alphabet.size(), _dimension));
+  int index = 0;
+  for (int i = 0; i < characters; i++) {
+    index = index * blank + codes[i];
+  }
+  return this->stringOffsets[characters] + index;
 }
 
-void SubmatrixCalculator::calculate() {
-  generateInitialSteps(0, "");
-  generateInitialStrings(0, "", false);
-  calculateOffsets();
+// writes the symbol codes of the string with the given index; inverse of
+// getStringIndex()
+void SubmatrixCalculator::getStringCodes(int index, uint8_t* codes) const {
+  int blank = this->alphabet.size();
+  int characters = 0;
+  while (index < this->stringOffsets[characters]) {
+    characters++;
+  }
+
+  index -= this->stringOffsets[characters];
+  for (int i = this->dimension - 1; i >= characters; i--) {
+    codes[i] = blank;
+  }
+  for (int i = characters - 1; i >= 0; i--) {
+    codes[i] = index % blank;
+    index /= blank;
+  }
+}
+
+/*
+    Switches the table to lazy mode: no entry is calculated up front, each
+    one is calculated the first time getFinalSteps() asks for it and kept in
+    a direct-mapped store of 2^storeBits slots. Table cost is then
+    proportional to the blocks a solver actually visits, which makes
+    dimensions far too large to materialize usable.
+*/
+void SubmatrixCalculator::calculateLazy(int storeBits) {
+  storeBits = max(1, min(storeBits, 40));
+  PhaseTimer timer(Metrics::TABLE_ALLOCATION);
+  delete[] this->lazyStore;
+  this->lazyStore = new atomic<uint64_t>[1ULL << storeBits]();
+  this->lazyShift = 64 - storeBits;
+  vector<uint16_t>().swap(this->pathIndex);
+  calculatePairBases();
+}
+
+/*
+    Lazy-mode lookup of the entry of the (first, second) string pair with the
+    given step codes, in stored orientation.
+    A slot holds the entry key above the two result bytes, so a slot that
+    was overwritten by another key (or by a concurrent solver) is recognized
+    as a miss; since every slot is a single atomic word, the store needs no
+    locking and a racing duplicate calculation just writes the same value.
+*/
+pair<int, int> SubmatrixCalculator::getLazyFinalSteps(unsigned int pairIndex,
+                                                      int stepLeft,
+                                                      int stepTop) const {
+  // + 1 keeps every key distinct from an empty slot
+  uint64_t key =
+      ((uint64_t)pairIndex * this->stepCount + stepLeft) * this->stepCount +
+      stepTop + 1;
+  atomic<uint64_t>& slot =
+      this->lazyStore[(key * 0x9E3779B97F4A7C15ULL) >> this->lazyShift];
+
+  uint64_t entry = slot.load(memory_order_relaxed);
+  if ((entry >> 16) == key) {
+    return make_pair((int)(entry >> 8) & 0xff, (int)entry & 0xff);
+  }
+
+  uint8_t strLeft[SUBMATRIX_MAX_DIMENSION];
+  uint8_t strTop[SUBMATRIX_MAX_DIMENSION];
+  getStringCodes(pairIndex / this->stringCount, strLeft);
+  getStringCodes(pairIndex % this->stringCount, strTop);
+
+  Scratch scratch;
+  pair<int, int> steps =
+      calculateFinalSteps(strLeft, strTop, stepLeft, stepTop, scratch);
+  Metrics::add(Metrics::TABLE_ENTRIES, 1);
+  slot.store((key << 16) | (steps.first << 8) | steps.second,
+             memory_order_relaxed);
+  return steps;
+}
+
+void SubmatrixCalculator::calculate(int threads) {
+  if (!tableFits()) {
+    cout << "Submatrix table too large for dimension " << this->dimension << endl;
+    exit(1);
+  }
 
   // allocate the memory locations required to store the submatrices
-  int startTime = clock();
-  int memoryRequired = charLeftOffset[this->dimension - 1][this->alphabet.size()] + charLeftOffset[this->dimension - 1][1] + 5;
-  cout << "Allocating " << memoryRequired << " locations." << endl;
-  this->resultIndex = new pair<int, int>[memoryRequired];
-  this->times[0] = (clock() - startTime) / double(CLOCKS_PER_SEC);
-  cout << "Allocation time: " << this->times[0] << "s" << endl;
-
-  // setting up temporary matrix storage
-  lastSubH.reserve(this->dimension + 1);
-  lastSubV.reserve(this->dimension + 1);
-  vector<int> rowVec(this->dimension + 1, 0);
-  for (int i = 0; i <= this->dimension; i++) {
-    lastSubH.push_back(rowVec);
-    lastSubV.push_back(rowVec);
-  }
-
-  // all possible initial steps and strings combinations
-  startTime = clock();
-  for (unsigned int strA = 0; strA < initialStrings.size(); strA++) {
-    for (unsigned int strB = 0; strB < initialStrings.size(); strB++) {
-      for (unsigned int stepC = 0; stepC < initialSteps.size(); stepC++) {
-        for (unsigned int stepD = 0; stepD < initialSteps.size(); stepD++) {
-          // storing the resulting final rows for future reference
-          int offset = getOffset(initialStrings[strA], initialStrings[strB], initialSteps[stepC], initialSteps[stepD]);
-        //  cout << stepOffsets[0][stepsToInt(stepsToVector(initialSteps[stepC]))] << " " << stepOffsets[1][stepsToInt(stepsToVector(initialSteps[stepD]))] << endl;
-         // cout << initialSteps[stepC] << " " << initialSteps[stepD] << " to " << stepsToInt(stepsToVector(initialSteps[stepC])) << " " << stepsToInt(stepsToVector(initialSteps[stepD])) << endl;
-         // system("pause");
-          resultIndex[offset] =
-              calculateFinalSteps(initialStrings[strA], initialStrings[strB],
-                                  initialSteps[stepC], initialSteps[stepD]);
+  {
+    PhaseTimer timer(Metrics::TABLE_ALLOCATION);
+    delete[] this->resultIndex;
+    this->resultIndex = new uint8_t[2 * this->resultSize];
+  }
+
+  if (threads <= 0) {
+    threads = thread::hardware_concurrency();
+  }
+  // every thread takes whole left strings, so more threads would stay idle
+  threads = max(1, min(threads, this->stringCount));
+
+  // all possible initial steps and strings combinations; the entries are
+  // independent, so the left strings are handed out to the threads one by one
+  PhaseTimer timer(Metrics::TABLE_GENERATION);
+  atomic<unsigned int> nextString(0);
+
+  vector<thread> workers;
+  for (int i = 1; i < threads; i++) {
+    workers.push_back(thread([this, &nextString]() {
+      PhaseTimer cpu(Metrics::TABLE_GENERATION, false);
+      calculateRange(&nextString);
+    }));
+  }
+  calculateRange(&nextString);
+  for (unsigned int i = 0; i < workers.size(); i++) {
+    workers[i].join();
+  }
+  Metrics::add(Metrics::TABLE_ENTRIES, this->resultSize);
+}
+
+/*
+    Worker loop of calculate(). Repeatedly claims the next unprocessed top
+    string and calculates every submatrix stored with it, using its own
+    scratch matrices.
+*/
+void SubmatrixCalculator::calculateRange(atomic<unsigned int>* nextString) {
+  Scratch scratch;
+  RowContext context;
+  context.scratch = &scratch;
+
+  for (unsigned int strB = (*nextString)++; (int)strB < this->stringCount;
+       strB = (*nextString)++) {
+    context.topIndex = strB;
+    getStringCodes(strB, context.topChars);
+
+    for (int stepD = 0; stepD < this->stepCount; stepD++) {
+      context.topSteps = stepD;
+
+      // the top row is shared by every left string and left step vector
+      int topSteps[SUBMATRIX_MAX_DIMENSION];
+      decodeSteps(stepD, topSteps);
+      scratch.subV[0][0] = scratch.subH[0][0] = 0;
+      for (int j = 1; j <= this->dimension; j++) {
+        scratch.subH[0][j] = topSteps[j - 1];
+      }
+
+      calculateRows(context, 1, 0, 0, false, 0, 0);
+    }
+  }
+}
+
+/*
+    Enumerates left strings and left step vectors row by row, like an
+    odometer whose last row turns fastest. Row i of a submatrix depends only
+    on the top row and on the first i characters and steps on the left, so
+    combinations sharing a prefix share its rows, and every combination only
+    calculates the rows below the prefix it shares with the previous one.
+    The recursion state is the prefix so far: its number of alphabet
+    characters and their base-|alphabet| value, whether it ended with blanks,
+    and the codes of the left steps and of the right column steps.
+    In a symmetric table only left strings with index <= the top string index
+    are stored, so subtrees that only hold larger indices are skipped.
+*/
+void SubmatrixCalculator::calculateRows(RowContext& context, int row,
+                                        int prefixChars, int prefixCode,
+                                        bool blanks, int stepCode,
+                                        int rightCode) {
+  if (row > this->dimension) {
+    int leftIndex = this->stringOffsets[prefixChars] + prefixCode;
+    if (this->symmetric && leftIndex > context.topIndex) return;
+
+    int bottomCode = 0;
+    for (int j = 1; j <= this->dimension; j++) {
+      bottomCode = bottomCode * this->stepBase +
+                   context.scratch->subH[this->dimension][j] + this->stepOffset;
+    }
+
+    uint8_t* entry = this->resultIndex +
+                     2 * ((getPairBase(leftIndex, context.topIndex) >> 1) +
+                          stepCode * this->stepCount + context.topSteps);
+    entry[0] = rightCode;
+    entry[1] = bottomCode;
+    return;
+  }
+
+  int (*subV)[SUBMATRIX_MAX_DIMENSION + 1] = context.scratch->subV;
+  int (*subH)[SUBMATRIX_MAX_DIMENSION + 1] = context.scratch->subH;
+  int blank = this->alphabet.size();
+  int remaining = this->dimension - row;
+  int deleteCost = this->costs.deleteCost;
+  int insertCost = this->costs.insertCost;
+
+  for (int c = blanks ? blank : 0; c <= blank; c++) {
+    int nextChars = prefixChars;
+    int nextCode = prefixCode;
+    if (c != blank) {
+      nextChars++;
+      nextCode = prefixCode * blank + c;
+    }
+
+    if (this->symmetric && !blanks) {
+      // smallest string index reachable from this prefix
+      int lowest;
+      if (c != blank) {
+        lowest = nextCode;
+        for (int k = 0; k < remaining; k++) lowest *= blank;
+      } else {
+        lowest = this->stringOffsets[nextChars] + nextCode;
+      }
+      if (lowest > context.topIndex) {
+        if (c != blank) {
+          // larger characters only give larger indices; the blank may not
+          c = blank - 1;
         }
+        continue;
       }
     }
-    if (strA % 5 == 0 or strA == initialStrings.size() - 1) {
-      cout << strA + 1 << " / " << initialStrings.size() << " (submatrices: "
-           << (strA + 1) * initialStrings.size() * initialSteps.size() *
-                  initialSteps.size() << " )" << endl;
+
+    const int* replaceRow =
+        c != blank ? &this->replaceTable[c * blank] : NULL;
+    for (int step = -this->stepOffset; step <= this->stepOffset; step++) {
+      subV[row][0] = step;
+      for (int j = 1; j <= this->dimension; j++) {
+        if (c == blank or context.topChars[j - 1] == blank) {
+          subV[row][j] = subV[row][j - 1];
+          subH[row][j] = subH[row - 1][j];
+          continue;
+        }
+
+        int R = replaceRow[context.topChars[j - 1]];
+        int lastV = subV[row][j - 1];
+        int lastH = subH[row - 1][j];
+        subV[row][j] = mmin(R - lastH, deleteCost, insertCost + lastV - lastH);
+        subH[row][j] = mmin(R - lastV, insertCost, deleteCost + lastH - lastV);
+      }
+
+      calculateRows(context, row + 1, nextChars, nextCode, c == blank,
+                    stepCode * this->stepBase + step + this->stepOffset,
+                    rightCode * this->stepBase + subV[row][this->dimension] +
+                        this->stepOffset);
     }
   }
-  this->times[1] = (clock() - startTime) / double(CLOCKS_PER_SEC);
-  cout << "Submatrix calculation time: " << this->times[1] << "s" << endl;
 }
 
 /*
-    Backtracks through the submatrix, represented by the standard 4 provided
-   strings, until it
-    leaves the bounds and enters another submatrix. Returns the coordinates of
-   the next submatrix
-    entered, the entry cell in the next submatrix, and a vector of operations
-   used to traverse
-    the current matrix.
-    The initialCost parameter combined with the two initial step vectors are
-   used to calculate
-    the edit distance submatrix because it's easier to backtrack through a
-   cost-matrix than
-    through a step matrix.
+    The path table of a materialized table: each path takes 2 bits per
+    operation of at most 2 * dimension - 1 operations, which fits in 16 bits
+    up to dimension 4, and the table is held to the size limit of the
+    result table.
+*/
+bool SubmatrixCalculator::pathTableFits() const {
+  if (this->lazyStore != NULL || this->pairBases.empty()) return false;
+  if (2 * (2 * this->dimension - 1) > 16) return false;
+  size_t orientations = this->symmetric ? 2 : 1;
+  return this->resultSize * orientations * (2 * this->dimension - 1) * 2 <=
+         SUBMATRIX_MAX_TABLE_BYTES;
+}
+
+/*
+    Precalculates the path table: for every entry the traceback from each
+    cell of the bottom row and the right column, which are the cells a
+    traceback enters a submatrix at, so getStoredPath() replaces building
+    the cost submatrix of every block on the path with one lookup. Entries
+    of a symmetric table are stored for one orientation of the pair only,
+    so their paths are calculated for both orientations; tracing the
+    transposed submatrix would break ties the other way.
+    The table takes 2 * (2 * dimension - 1) bytes per entry and orientation,
+    10 times the result table for dimension 3. threads = 0 uses every core.
+*/
+void SubmatrixCalculator::calculatePaths(int threads) {
+  if (!pathTableFits()) {
+    cout << "Submatrix path table too large for dimension " << this->dimension
+         << endl;
+    exit(1);
+  }
+
+  this->pathCells = 2 * this->dimension - 1;
+  {
+    PhaseTimer timer(Metrics::TABLE_ALLOCATION);
+    size_t orientations = this->symmetric ? 2 : 1;
+    this->pathIndex.assign(this->resultSize * orientations * this->pathCells,
+                           0);
+  }
+
+  if (threads <= 0) {
+    threads = thread::hardware_concurrency();
+  }
+  threads = max(1, min(threads, this->stringCount));
+
+  // like calculate(), the first strings of the stored pairs are handed out
+  // to the threads one by one
+  PhaseTimer timer(Metrics::TABLE_GENERATION);
+  atomic<unsigned int> nextString(0);
+
+  vector<thread> workers;
+  for (int i = 1; i < threads; i++) {
+    workers.push_back(thread([this, &nextString]() {
+      PhaseTimer cpu(Metrics::TABLE_GENERATION, false);
+      calculatePathRange(&nextString);
+    }));
+  }
+  calculatePathRange(&nextString);
+  for (unsigned int i = 0; i < workers.size(); i++) {
+    workers[i].join();
+  }
+}
+
+/*
+    Worker loop of calculatePaths(). Repeatedly claims the next unprocessed
+    first string and traces every entry stored with it.
 */
-pair<vector<int>, pair<pair<int, int>, pair<int, int> > >
-SubmatrixCalculator::getSubmatrixPath(string strLeft, string strTop,
-                                      int stepLeft, int stepTop,
-                                      int finalRow, int finalCol,
-                                      int initialCost) {
-  calculateCostSubmatrix(strLeft, strTop, stepLeft, stepTop, initialCost);
+void SubmatrixCalculator::calculatePathRange(
+    atomic<unsigned int>* nextString) {
+  Scratch scratch;
+  uint8_t first[SUBMATRIX_MAX_DIMENSION];
+  uint8_t second[SUBMATRIX_MAX_DIMENSION];
+  int orientations = this->symmetric ? 2 : 1;
+
+  for (unsigned int strA = (*nextString)++; (int)strA < this->stringCount;
+       strA = (*nextString)++) {
+    getStringCodes(strA, first);
+    for (int strB = this->symmetric ? strA : 0; strB < this->stringCount;
+         strB++) {
+      getStringCodes(strB, second);
+      size_t base = getPairBase(strA, strB) >> 1;
+
+      for (int stepA = 0; stepA < this->stepCount; stepA++) {
+        for (int stepB = 0; stepB < this->stepCount; stepB++) {
+          uint16_t* paths =
+              &this->pathIndex[(base + stepA * this->stepCount + stepB) *
+                               orientations * this->pathCells];
+          for (int orientation = 0; orientation < orientations;
+               orientation++) {
+            // the second orientation is the pair the other way round
+            if (orientation == 0) {
+              calculateCostSubmatrix(first, second, stepA, stepB, 0, scratch);
+            } else {
+              calculateCostSubmatrix(second, first, stepB, stepA, 0, scratch);
+            }
+
+            // cells 0 .. dimension - 1 are the bottom row, the rest the
+            // right column above it
+            for (int cell = 0; cell < this->pathCells; cell++) {
+              int i = cell < this->dimension ? this->dimension
+                                             : cell - this->dimension + 1;
+              int j = cell < this->dimension ? cell + 1 : this->dimension;
+              unsigned int path = 0;
+              for (int shift = 0; i > 0 && j > 0; shift += 2) {
+                int operation = scratch.subH[i][j];
+                path |= operation << shift;
+                if (operation != 2) i--;
+                if (operation != 1) j--;
+              }
+              paths[orientation * this->pathCells + cell] = path;
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+/*
+    Backtracks through the submatrix, represented by its two strings and two
+    initial step vectors, from the cell (finalRow, finalCol) until it leaves
+    the bounds and enters another submatrix. Appends the operations used to
+    traverse the current matrix to operations and stores the offset of the
+    next submatrix entered and the cell it continues from in exit.
+    The path only depends on the differences between cells, so the cost
+    submatrix is built from an initial cost of 0; it's easier to backtrack
+    through a cost-matrix than through a step matrix.
+    Uses its own scratch matrices, so a single table can serve any number of
+    solvers at once.
+*/
+void SubmatrixCalculator::getSubmatrixPath(const uint8_t* strLeft,
+                                           const uint8_t* strTop,
+                                           int stepLeft, int stepTop,
+                                           int finalRow, int finalCol,
+                                           vector<int>& operations,
+                                           PathExit& exit) const {
+  Scratch scratch;
+  calculateCostSubmatrix(strLeft, strTop, stepLeft, stepTop, 0, scratch);
 
   int i = finalRow;
   int j = finalCol;
-  vector<int> operations;
   // backtracking - for movement check
   // SubmatrixCalculator::calculateCostSubmatrix
   while (i > 0 && j > 0) {
-    operations.push_back(lastSubH[i][j]);
-    if (operations[operations.size() - 1] == 1) {
+    int operation = scratch.subH[i][j];
+    operations.push_back(operation);
+    if (operation == 1) {
       i--;
-    } else if (operations[operations.size() - 1] == 2) {
+    } else if (operation == 2) {
       j--;
     } else {
       i--;
@@ -129,81 +621,132 @@ SubmatrixCalculator::getSubmatrixPath(string strLeft, string strTop,
     }
   }
 
-  // calculate the next matrix to enter depending on the initial vector we ended
-  // up on
-  // if i == 0, go left, if j == 0 go up, if both are 0 go diagonally up-left
-  pair<int, int> nextMatrix;
-  pair<int, int> nextCell;
+  setPathExit(i, j, exit);
+}
+
+/*
+    Looks the traceback from the cell (finalRow, finalCol) up in the path
+    table instead, see getSubmatrixPath(). Only cells of the bottom row and
+    the right column are stored.
+*/
+bool SubmatrixCalculator::getStoredPath(unsigned int pairBase, int stepLeft,
+                                        int stepTop, int finalRow,
+                                        int finalCol, vector<int>& operations,
+                                        PathExit& exit) const {
+  if (this->pathIndex.empty() ||
+      (finalRow != this->dimension && finalCol != this->dimension)) {
+    return false;
+  }
+
+  // the entry like getFinalSteps(); swapped pairs use the second orientation
+  unsigned int swapped = pairBase & 1;
+  size_t first = swapped ? stepTop : stepLeft;
+  size_t second = swapped ? stepLeft : stepTop;
+  size_t entry = (pairBase >> 1) + first * this->stepCount + second;
+  int cell = finalRow == this->dimension ? finalCol - 1
+                                         : this->dimension + finalRow - 1;
+  size_t orientations = this->symmetric ? 2 : 1;
+  unsigned int path =
+      this->pathIndex[(entry * orientations + swapped) * this->pathCells +
+                      cell];
+
+  int i = finalRow;
+  int j = finalCol;
+  for (; path != 0; path >>= 2) {
+    int operation = path & 3;
+    operations.push_back(operation);
+    if (operation != 2) i--;
+    if (operation != 1) j--;
+  }
+  setPathExit(i, j, exit);
+  return true;
+}
+
+/*
+    Stores where a traceback that left the submatrix at the cell (i, j) of
+    its first row or column continues.
+*/
+void SubmatrixCalculator::setPathExit(int i, int j, PathExit& exit) const {
+  // if i == 0, go up, if j == 0 go left, if both are 0 go diagonally up-left
   if (i == 0 && j == 0) {
-    nextMatrix = make_pair(-1, -1);
-    nextCell = make_pair(this->dimension, this->dimension);
+    exit.matrixRow = exit.matrixCol = -1;
+    exit.cellRow = exit.cellCol = this->dimension;
   } else if (i == 0) {
-    nextMatrix = make_pair(-1, 0);
-    nextCell = make_pair(this->dimension, j);
+    exit.matrixRow = -1;
+    exit.matrixCol = 0;
+    exit.cellRow = this->dimension;
+    exit.cellCol = j;
   } else {
-    nextMatrix = make_pair(0, -1);
-    nextCell = make_pair(i, this->dimension);
+    exit.matrixRow = 0;
+    exit.matrixCol = -1;
+    exit.cellRow = i;
+    exit.cellCol = this->dimension;
   }
-
-  return make_pair(operations, make_pair(nextMatrix, nextCell));
 }
 
 /*
      Calculates the cost submatrix represented by the provided two strings and
    two initial vectors.
-     The cost matrix has two parts, stored in lastSubV and lastSubH (recycled
-   matrices to save space).
-     The lastSubV matrix stores the costs and the lastSubH matrix stores the
+     The cost matrix has two parts, stored in the subV and subH matrices of
+   the provided scratch.
+     The subV matrix stores the costs and the subH matrix stores the
    optimal paths.
-     Path codes inside lastSubH:
+     Path codes inside subH:
      0 - initial vector cell, exiting the submatrix
      1 - moving up in the submatrix (deleting)
      2 - moving left in the submatrix (inserting)
      3 - moving diagonally up-left in the submatrix (replacing / matching)
 */
-void SubmatrixCalculator::calculateCostSubmatrix(string strLeft, string strTop,
+void SubmatrixCalculator::calculateCostSubmatrix(const uint8_t* strLeft,
+                                                 const uint8_t* strTop,
                                                  int stepLeft, int stepTop,
-                                                 int initialCost) {
+                                                 int initialCost,
+                                                 Scratch& scratch) const {
+  int (*subV)[SUBMATRIX_MAX_DIMENSION + 1] = scratch.subV;
+  int (*subH)[SUBMATRIX_MAX_DIMENSION + 1] = scratch.subH;
+  int blank = this->alphabet.size();
 
-  vector <int> stepLeftVec = stepsToVector(stepLeft);
-  vector <int> stepTopVec = stepsToVector(stepTop);
+  int stepLeftVec[SUBMATRIX_MAX_DIMENSION];
+  int stepTopVec[SUBMATRIX_MAX_DIMENSION];
+  decodeSteps(stepLeft, stepLeftVec);
+  decodeSteps(stepTop, stepTopVec);
 
-  lastSubV[0][0] = initialCost;
-  lastSubH[0][0] = 0;
+  subV[0][0] = initialCost;
+  subH[0][0] = 0;
   for (int i = 1; i <= this->dimension; i++) {
-    lastSubV[0][i] = lastSubV[0][i - 1] + stepTopVec[i - 1];
-    lastSubV[i][0] = lastSubV[i - 1][0] + stepLeftVec[i - 1];
-    lastSubH[0][i] = 0;
-    lastSubH[i][0] = 0;
+    subV[0][i] = subV[0][i - 1] + stepTopVec[i - 1];
+    subV[i][0] = subV[i - 1][0] + stepLeftVec[i - 1];
+    subH[0][i] = 0;
+    subH[i][0] = 0;
   }
 
   for (int i = 1; i <= this->dimension; i++) {
     for (int j = 1; j <= this->dimension; j++) {
-      if (strLeft[i - 1] == blankCharacter) {
-        lastSubV[i][j] = lastSubV[i - 1][j];
-        lastSubH[i][j] = 1;
-      } else if (strTop[j - 1] == blankCharacter) {
-        lastSubV[i][j] = lastSubV[i][j - 1];
-        lastSubH[i][j] = 2;
+      if (strLeft[i - 1] == blank) {
+        subV[i][j] = subV[i - 1][j];
+        subH[i][j] = 1;
+      } else if (strTop[j - 1] == blank) {
+        subV[i][j] = subV[i][j - 1];
+        subH[i][j] = 2;
       } else {
 
         // replace
-        int R = (strLeft[i - 1] != strTop[j - 1]) * this->replaceCost;
-        lastSubV[i][j] = lastSubV[i - 1][j - 1] + R;
-        lastSubH[i][j] = 3;
+        int R = getReplaceCost(strLeft[i - 1], strTop[j - 1]);
+        subV[i][j] = subV[i - 1][j - 1] + R;
+        subH[i][j] = 3;
 
         // insert
-        int alternative = lastSubV[i][j - 1] + this->insertCost;
-        if (lastSubV[i][j] > alternative) {
-          lastSubV[i][j] = alternative;
-          lastSubH[i][j] = 2;
+        int alternative = subV[i][j - 1] + this->costs.insertCost;
+        if (subV[i][j] > alternative) {
+          subV[i][j] = alternative;
+          subH[i][j] = 2;
         }
 
         // delete
-        alternative = lastSubV[i - 1][j] + this->deleteCost;
-        if (lastSubV[i][j] > alternative) {
-          lastSubV[i][j] = alternative;
-          lastSubH[i][j] = 1;
+        alternative = subV[i - 1][j] + this->costs.deleteCost;
+        if (subV[i][j] > alternative) {
+          subV[i][j] = alternative;
+          subH[i][j] = 1;
         }
       }
     }
@@ -214,116 +757,307 @@ void SubmatrixCalculator::calculateCostSubmatrix(string strLeft, string strTop,
     Calculates the step submatrix represented by the provided two strings and
    two initial vectors.
     The step matrix has two parts, vertical and horizontal steps, stored in
-   lastSubV and lastSubH.
+   the subV and subH matrices of the provided scratch.
 */
-inline void SubmatrixCalculator::calculateSubmatrix(string strLeft,
-                                                    string strTop,
-                                                    string stepLeft,
-                                                    string stepTop) {
+inline void SubmatrixCalculator::calculateSubmatrix(const uint8_t* strLeft,
+                                                    const uint8_t* strTop,
+                                                    int stepLeft, int stepTop,
+                                                    Scratch& scratch) const {
+  int (*lastSubV)[SUBMATRIX_MAX_DIMENSION + 1] = scratch.subV;
+  int (*lastSubH)[SUBMATRIX_MAX_DIMENSION + 1] = scratch.subH;
+  int blank = this->alphabet.size();
+
+  int stepLeftVec[SUBMATRIX_MAX_DIMENSION];
+  int stepTopVec[SUBMATRIX_MAX_DIMENSION];
+  decodeSteps(stepLeft, stepLeftVec);
+  decodeSteps(stepTop, stepTopVec);
+
   for (int i = 1; i <= this->dimension; i++) {
-    lastSubV[i][0] = stepLeft[i - 1] - '1';
-    lastSubH[0][i] = stepTop[i - 1] - '1';
+    lastSubV[i][0] = stepLeftVec[i - 1];
+    lastSubH[0][i] = stepTopVec[i - 1];
   }
   lastSubV[0][0] = lastSubH[0][0] = 0;
 
   for (int i = 1; i <= this->dimension; i++) {
     for (int j = 1; j <= this->dimension; j++) {
-      if (strLeft[i - 1] == blankCharacter or strTop[j - 1] == blankCharacter) {
+      if (strLeft[i - 1] == blank or strTop[j - 1] == blank) {
         lastSubV[i][j] = lastSubV[i][j - 1];
         lastSubH[i][j] = lastSubH[i - 1][j];
         continue;
       }
 
-      int R = (strLeft[i - 1] != strTop[j - 1]) * this->replaceCost;
+      int R = getReplaceCost(strLeft[i - 1], strTop[j - 1]);
       int lastV = lastSubV[i][j - 1];
       int lastH = lastSubH[i - 1][j];
-      lastSubV[i][j] =
-          mmin(R - lastH, this->deleteCost, this->insertCost + lastV - lastH);
-      lastSubH[i][j] =
-          mmin(R - lastV, this->insertCost, this->deleteCost + lastH - lastV);
+      lastSubV[i][j] = mmin(R - lastH, this->costs.deleteCost,
+                            this->costs.insertCost + lastV - lastH);
+      lastSubH[i][j] = mmin(R - lastV, this->costs.insertCost,
+                            this->costs.deleteCost + lastH - lastV);
     }
   }
 }
 
 /*
-    Calculates the final step vectors for a given initial submatrix description.
+    Calculates the final step codes for a given initial submatrix description.
 */
-pair<int, int> SubmatrixCalculator::calculateFinalSteps(string strLeft,
-                                                        string strTop,
-                                                        string stepLeft,
-                                                        string stepTop) {
-  calculateSubmatrix(strLeft, strTop, stepLeft, stepTop);
+pair<int, int> SubmatrixCalculator::calculateFinalSteps(const uint8_t* strLeft,
+                                                        const uint8_t* strTop,
+                                                        int stepLeft,
+                                                        int stepTop,
+                                                        Scratch& scratch) const {
+  calculateSubmatrix(strLeft, strTop, stepLeft, stepTop, scratch);
 
-  vector<int> stepRight(this->dimension, 0);
+  int stepRight = 0;
+  int stepBot = 0;
   for (int i = 1; i <= this->dimension; i++) {
-    stepRight[i - 1] = lastSubV[i][this->dimension];
+    stepRight = stepRight * this->stepBase + scratch.subV[i][this->dimension] +
+                this->stepOffset;
+    stepBot = stepBot * this->stepBase + scratch.subH[this->dimension][i] +
+              this->stepOffset;
   }
-
-  vector<int> stepBot(this->dimension, 0);
-  for (int i = 1; i <= this->dimension; i++) {
-    stepBot[i - 1] = lastSubH[this->dimension][i];
-  }
-  return make_pair(stepsToInt(stepRight), stepsToInt(stepBot));
+  return make_pair(stepRight, stepBot);
 }
 
 /*
-    Generates all possible initial step vectors and stores them
-    into initialSteps. The arguments are recursion parameters,
-    call with (0, ""). The length of the generated step vectors depends
-    on the dimension of the submatrices.
+    Custom minimum function with 3 arguments to reduce function call
+    overhead.
 */
-void SubmatrixCalculator::generateInitialSteps(int pos, string currStep) {
-  if (pos == this->dimension) {
-    initialSteps.push_back(currStep);
-    return;
-  }
+inline int SubmatrixCalculator::mmin(int x, int y, int z) {
+  return x > y ? (y < z ? y : z) : x < z ? x : z;
+}
 
-  for (int i = -1; i <= 1; i++) {
-    string tmp = currStep;
-    tmp.push_back('1' + i);
-    generateInitialSteps(pos + 1, tmp);
+// DEBUG
+void SubmatrixCalculator::printDebug() {
+  for (int i = 0; i < this->stepCount; i++) {
+    int steps[SUBMATRIX_MAX_DIMENSION];
+    decodeSteps(i, steps);
+    for (int j = 0; j < this->dimension; j++)
+      cout << (steps[j] > 0 ? "+" : "") << steps[j] << " ";
+    cout << endl;
+  }
+  for (int i = 0; i < this->stringCount; i++) {
+    uint8_t codes[SUBMATRIX_MAX_DIMENSION];
+    getStringCodes(i, codes);
+    for (int j = 0; j < this->dimension; j++)
+      cout << (codes[j] < this->alphabet.size() ? this->alphabet[codes[j]]
+                                                : this->blankCharacter);
+    cout << endl;
   }
 }
+
 /*
-    Generates all possible string vectors and stores them
-    into initialStrings. The arguments are recursion parameters,
-    call with (0, "", 0). The length of the generated strings depends
-    on the dimension of the submatrices.
+    Layout of a table cache file. The header is followed by resultIndex,
+    starting at resultStart.
 */
-void SubmatrixCalculator::generateInitialStrings(int pos, string currString,
-                                                 bool blanks) {
-  if (pos == this->dimension) {
-    initialStrings.push_back(currString);
-    return;
-  }
+struct SubmatrixCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    int32_t dimension;
+    int32_t replaceCost;
+    int32_t deleteCost;
+    int32_t insertCost;
+    // FNV-1a hash of the substitution matrix, 0 without one
+    uint32_t replaceCostsHash;
+    int32_t blankCharacter;
+    int32_t alphabetSize;
+    char alphabet[256];
+    uint64_t resultSize;
+    uint64_t resultStart;
+    // see resultChecksum()
+    uint64_t resultChecksum;
+    // set by the first load() whose checksum matched; not part of the
+    // parameters load() compares
+    uint64_t verified;
+};
+
+static const char CACHE_MAGIC[8] = {'B', 'I', 'O', 'S', 'U', 'B', 'M', 0};
+static const uint32_t CACHE_BYTE_ORDER = 0x01020304;
+
+// identifies a substitution matrix in cache file names and headers
+static uint32_t replaceCostsHash(const EditCosts& costs) {
+    if (costs.replaceCosts.empty()) return 0;
+    uint32_t hash = 2166136261u;
+    for (unsigned int i = 0; i < costs.replaceCosts.size(); i++) {
+        uint32_t value = costs.replaceCosts[i];
+        for (int byte = 0; byte < 4; byte++) {
+            hash = (hash ^ ((value >> (8 * byte)) & 0xff)) * 16777619u;
+        }
+    }
+    return hash;
+}
 
-  if (!blanks) {
+/*
+    Cache file name for this table's parameters. The alphabet and blank
+    character are hex-encoded so any alphabet gives a valid file name.
+*/
+string SubmatrixCalculator::cacheFileName() const {
+    char buffer[64];
+    string name = "submatrix-v";
+    snprintf(buffer, sizeof(buffer), "%d-t%d-", SUBMATRIX_CACHE_VERSION,
+             this->dimension);
+    name += buffer;
     for (unsigned int i = 0; i < this->alphabet.size(); i++) {
-      string tmp = currString;
-      tmp.push_back(this->alphabet[i]);
-      generateInitialStrings(pos + 1, tmp, false);
+        snprintf(buffer, sizeof(buffer), "%02x", (unsigned char)this->alphabet[i]);
+        name += buffer;
     }
-  }
+    snprintf(buffer, sizeof(buffer), "-b%02x-c%d-%d-%d",
+             (unsigned char)this->blankCharacter, this->costs.replaceCost,
+             this->costs.deleteCost, this->costs.insertCost);
+    name += buffer;
+    if (!this->costs.replaceCosts.empty()) {
+        snprintf(buffer, sizeof(buffer), "-m%08x",
+                 replaceCostsHash(this->costs));
+        name += buffer;
+    }
+    name += ".bin";
+    return name;
+}
+
+/*
+    FNV-1a over the 64-bit words of the result table, then its remaining
+    bytes; catches damaged cache files before their step codes are used as
+    table indices. Word-wise so checking a large table stays cheap.
+*/
+static uint64_t resultChecksum(const uint8_t* data, size_t bytes) {
+    uint64_t hash = 14695981039346656037ULL;
+    size_t words = bytes / 8;
+    for (size_t i = 0; i < words; i++) {
+        uint64_t word;
+        memcpy(&word, data + 8 * i, 8);
+        hash = (hash ^ word) * 1099511628211ULL;
+    }
+    for (size_t i = 8 * words; i < bytes; i++) {
+        hash = (hash ^ data[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
 
-  string tmp = currString;
-  tmp.push_back(blankCharacter);
-  generateInitialStrings(pos + 1, tmp, true);
+// fills the cache header fields describing this table's parameters
+static void fillCacheHeader(SubmatrixCacheHeader& header, int dimension,
+                            const string& alphabet, char blankCharacter,
+                            const EditCosts& costs, size_t resultSize) {
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = SUBMATRIX_CACHE_VERSION;
+    header.byteOrder = CACHE_BYTE_ORDER;
+    header.dimension = dimension;
+    header.replaceCost = costs.replaceCost;
+    header.deleteCost = costs.deleteCost;
+    header.insertCost = costs.insertCost;
+    header.replaceCostsHash = replaceCostsHash(costs);
+    header.blankCharacter = (unsigned char)blankCharacter;
+    header.alphabetSize = alphabet.size();
+    memcpy(header.alphabet, alphabet.data(), alphabet.size());
+    header.resultSize = resultSize;
 }
 
 /*
-    Custom minimum function with 3 arguments to reduce function call
-    overhead.
+    Writes the calculated table to a cache file. The file is written under a
+    temporary name and renamed into place, so concurrent readers never see a
+    partially written table.
 */
-inline int SubmatrixCalculator::mmin(int x, int y, int z) {
-  return x > y ? (y < z ? y : z) : x < z ? x : z;
+bool SubmatrixCalculator::save(const string& path) const {
+    if (this->resultIndex == NULL || this->lazyStore != NULL ||
+        this->alphabet.size() > 256) return false;
+
+    SubmatrixCacheHeader header;
+    fillCacheHeader(header, this->dimension, this->alphabet,
+                    this->blankCharacter, this->costs, this->resultSize);
+
+    // the result table starts on a page boundary
+    uint64_t pageSize = sysconf(_SC_PAGESIZE);
+    header.resultStart = (sizeof(header) + pageSize - 1) / pageSize * pageSize;
+    header.resultChecksum =
+        resultChecksum(this->resultIndex, 2 * this->resultSize);
+
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".tmp%d", (int)getpid());
+    string tempPath = path + suffix;
+
+    FILE* out = fopen(tempPath.c_str(), "wb");
+    if (out == NULL) return false;
+
+    vector<char> padding(header.resultStart - sizeof(header), 0);
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+    ok = ok && fwrite(padding.data(), 1, padding.size(), out) == padding.size();
+    ok = ok && fwrite(this->resultIndex, 2, this->resultSize, out) ==
+                   this->resultSize;
+    ok = (fclose(out) == 0) && ok;
+
+    if (!ok || rename(tempPath.c_str(), path.c_str()) != 0) {
+        unlink(tempPath.c_str());
+        return false;
+    }
+    return true;
 }
 
-// DEBUG
-void SubmatrixCalculator::printDebug() {
-  for (unsigned int i = 0; i < initialSteps.size(); i++)
-    cout << stepsToPrettyString(initialSteps[i]) << endl;
-  for (unsigned int i = 0; i < initialStrings.size(); i++)
-    cout << initialStrings[i] << endl;
+/*
+    Maps a table written by save() read-only, so processes using the same
+    cache file share one page-cache copy of it. Files whose header does not
+    match are rejected. The checksum reads every page of the table, so only
+    the first load after save() checks it and then marks the file verified;
+    later loads map it without touching the body.
+*/
+bool SubmatrixCalculator::load(const string& path) {
+    if (this->lazyStore != NULL || !tableFits()) return false;
+
+    // writable where allowed, so the first load can mark the file verified
+    int fd = open(path.c_str(), O_RDWR);
+    if (fd < 0) fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(SubmatrixCacheHeader)) {
+        close(fd);
+        return false;
+    }
+
+    void* data = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+
+    // the file has to match the parameters of this calculator exactly
+    const SubmatrixCacheHeader* header = (const SubmatrixCacheHeader*)data;
+    SubmatrixCacheHeader expected;
+    fillCacheHeader(expected, this->dimension, this->alphabet,
+                    this->blankCharacter, this->costs, this->resultSize);
+
+    bool valid =
+        memcmp(header, &expected, offsetof(SubmatrixCacheHeader, resultStart)) == 0 &&
+        header->resultStart >= sizeof(SubmatrixCacheHeader) &&
+        header->resultStart + 2 * header->resultSize == (uint64_t)info.st_size;
+    // the body as well on the first load, so a file damaged while being
+    // written is recalculated instead of used
+    if (valid && header->verified == 0) {
+        valid = resultChecksum((const uint8_t*)data + header->resultStart,
+                               2 * header->resultSize) ==
+                header->resultChecksum;
+        uint64_t verified = 1;
+        if (valid && pwrite(fd, &verified, sizeof(verified),
+                            offsetof(SubmatrixCacheHeader, verified)) !=
+                         (ssize_t)sizeof(verified)) {
+            // e.g. a read-only cache directory: the next load checks again
+        }
+    }
+    close(fd);
+    if (!valid) {
+        munmap(data, info.st_size);
+        return false;
+    }
+
+    if (this->mappedData != NULL) {
+        munmap(this->mappedData, this->mappedSize);
+    } else {
+        delete[] this->resultIndex;
+    }
+    this->mappedData = data;
+    this->mappedSize = info.st_size;
+    this->resultIndex = (uint8_t*)data + header->resultStart;
+
+    return true;
 }
 
 /*int main() {
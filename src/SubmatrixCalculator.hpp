@@ -10,280 +10,329 @@
 #include <cstdlib>
 #include <ctime>
 #include <numeric>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <stdint.h>
+
+#include "EditCosts.hpp"
+#include "Metrics.hpp"
 
 using namespace std;
 
+// version of the table cache file layout; bump on any layout change
+#define SUBMATRIX_CACHE_VERSION 5
+// largest supported dimension; every step vector code has to fit in a byte,
+// which limits the dimension further for costs other than 1 (see
+// maxDimension)
+#define SUBMATRIX_MAX_DIMENSION 5
+// default number of slots of a lazy table, as a power of two (8 MB)
+#define SUBMATRIX_LAZY_BITS 20
+// largest table calculated up front, in bytes; larger ones are lazy
+#define SUBMATRIX_MAX_TABLE_BYTES (1ULL << 28)
+
+/*
+Table layout:
+- a step is the cost difference of neighbouring cells; with m the larger of
+  the insert and delete costs every step lies in [-m, m] (vertical ones in
+  [-insertCost, deleteCost], horizontal ones in [-deleteCost, insertCost])
+- step vectors are base-(2m + 1) codes, one digit (step + m) per step with
+  the first step as the most significant digit, so codes are dense in
+  [0, (2m + 1)^dimension); for unit costs that is base 3 with digits step + 1
+- strings are dense indices of the strings that can appear in a block: some
+  alphabet characters followed by blanks only (see getStringIndex)
+- an entry is two bytes, the codes of the final right column and bottom row
+- with equal insert and delete costs and a symmetric substitution matrix a
+  submatrix and its transpose (left and top strings and steps swapped) have
+  swapped results, so only pairs with left index <= top index are stored
+- in lazy mode (see calculateLazy) entries are calculated on first use and
+  memoized in a direct-mapped store keyed by 64-bit entry keys
+- the optional path table (see calculatePaths) holds, for every entry and
+  every cell of the bottom row and right column, the traceback from that
+  cell as 2-bit operation codes, the first operation in the lowest bits; a
+  symmetric table keeps the paths of both orientations of each entry
+*/
 class SubmatrixCalculator {
 public:
+    /*
+        Scratch matrices holding one submatrix while it is being calculated.
+        Fixed-size, so it lives on the stack; every generating thread owns
+        its own, so the table can be calculated in parallel.
+    */
+    struct Scratch {
+        int subH[SUBMATRIX_MAX_DIMENSION + 1][SUBMATRIX_MAX_DIMENSION + 1];
+        int subV[SUBMATRIX_MAX_DIMENSION + 1][SUBMATRIX_MAX_DIMENSION + 1];
+    };
+
+    /*
+        Where a traceback continues after leaving a submatrix: the offset of
+        the next submatrix (-1 or 0 in each direction) and the cell of that
+        submatrix it continues from.
+    */
+    struct PathExit {
+        int matrixRow, matrixCol;
+        int cellRow, cellCol;
+    };
+
     SubmatrixCalculator();
     SubmatrixCalculator(int _dimension, string _alphabet = "ATGC",
                         char _blankCharacter = '-', int _replaceCost = 1,
                         int _deleteCost = 1, int _insertCost = 1);
+    SubmatrixCalculator(int _dimension, string _alphabet,
+                        char _blankCharacter, const EditCosts& _costs);
     ~SubmatrixCalculator();
-    void calculate();
-    pair<vector<int>, pair<pair<int, int>, pair<int, int> > > getSubmatrixPath(
-        string strLeft, string strTop, int stepLeft, int stepTop,
-        int finalRow, int finalCol, int initialCost);
-    void calculateCostSubmatrix(string strLeft, string strTop, int stepLeft,
-                                int stepTop, int initialCost);
-    inline void calculateSubmatrix(string strLeft, string strTop, string stepLeft,
-                                   string stepTop);
-    pair<int, int> calculateFinalSteps(string strLeft, string strTop,
-            string stepLeft, string stepTop);
-    void generateInitialSteps(int pos, string currStep);
-    void generateInitialStrings(int pos, string currString, bool blanks);
-    void printDebug();
-    inline int mmin(int x, int y, int z);
+    // calculates the whole table; threads = 0 uses every available core
+    void calculate(int threads = 0);
+    // calculates entries on first use instead; see the definition
+    void calculateLazy(int storeBits = SUBMATRIX_LAZY_BITS);
+    // whether the whole table is small enough to be calculated up front
+    bool tableFits() const;
+    // precalculates the traceback of every entry; see the definition
+    void calculatePaths(int threads = 0);
+    // whether calculatePaths() can build the path table of this table
+    bool pathTableFits() const;
+    bool hasPaths() const { return !pathIndex.empty(); }
+    bool isLazy() const { return lazyStore != NULL; }
+    // writes the calculated table to a cache file; returns false on failure
+    bool save(const string& path) const;
+    // maps a table written by save() read-only; returns false if the file is
+    // missing or was written for different parameters
+    bool load(const string& path);
+    // cache file name for this table's parameters
+    string cacheFileName() const;
 
     /*
-         Returns the sum of the step values for a given step string.
-     */
-    inline int sumSteps(string steps) {
-        vector<int> stepValues = stepsToVector(steps);
-        return accumulate(stepValues.begin(), stepValues.end(), 0);
+        Strings are passed as arrays of dimension symbol codes (see
+        symbolCode()) and step vectors as step codes, so none of the
+        functions below allocate.
+    */
+    void getSubmatrixPath(const uint8_t* strLeft, const uint8_t* strTop,
+                          int stepLeft, int stepTop, int finalRow,
+                          int finalCol, vector<int>& operations,
+                          PathExit& exit) const;
+    // the same from the path table, for a submatrix described by its pair
+    // base and step codes; returns false when the table has no paths or
+    // the cell is not on the bottom row or right column
+    bool getStoredPath(unsigned int pairBase, int stepLeft, int stepTop,
+                       int finalRow, int finalCol, vector<int>& operations,
+                       PathExit& exit) const;
+    void calculateCostSubmatrix(const uint8_t* strLeft, const uint8_t* strTop,
+                                int stepLeft, int stepTop, int initialCost,
+                                Scratch& scratch) const;
+    inline void calculateSubmatrix(const uint8_t* strLeft,
+                                   const uint8_t* strTop, int stepLeft,
+                                   int stepTop, Scratch& scratch) const;
+    pair<int, int> calculateFinalSteps(const uint8_t* strLeft,
+                                       const uint8_t* strTop, int stepLeft,
+                                       int stepTop, Scratch& scratch) const;
+    void printDebug();
+    static inline int mmin(int x, int y, int z);
+    // largest dimension whose step codes fit in a byte with these costs
+    static int maxDimension(const EditCosts& costs);
+
+    // getters for the parameters the table was calculated with
+    int getDimension() const { return dimension; }
+    const string& getAlphabet() const { return alphabet; }
+    char getBlankCharacter() const { return blankCharacter; }
+    // number of distinct strings and step vectors of length dimension
+    int getStringCount() const { return stringCount; }
+    int getStepCount() const { return stepCount; }
+    const EditCosts& getCosts() const { return costs; }
+    int getDeleteCost() const { return costs.deleteCost; }
+    int getInsertCost() const { return costs.insertCost; }
+    // whether the table was calculated for the classic unit costs
+    bool hasUnitCosts() const { return unitCosts; }
+    // whether swapping the two strings keeps every distance
+    bool isSymmetric() const { return symmetric; }
+
+    // cost of replacing the symbol with code x by the symbol with code y
+    inline int getReplaceCost(int x, int y) const {
+        return replaceTable[x * alphabet.size() + y];
     }
 
     /*
-       Returns the precalculated final step vectors for a given initial submatrix
-       description.
-       Unused to reduce function overhead.
+        Returns the table base of the submatrix with the given left and top
+        string indices. The base is shifted left by one; the lowest bit is set
+        when the pair is stored transposed. Pass the value to getFinalSteps().
     */
-   /* inline pair<string, string> getFinalSteps(string strLeft, string strTop,
-            string stepLeft, string stepTop) {
-        return resultIndex[getOffset(strLeft, strTop, stepLeft, stepTop)];
-    }*/
+    inline unsigned int getPairBase(int strLeft, int strTop) const {
+        return pairBases[strLeft * stringCount + strTop];
+    }
 
     /*
-        Transforms the step vector to a string. The string characters have no
-       special meaning,
-        strings are used for easier mapping. Check
-       SubmatrixCalculator::stepsToVector comments.
+        Returns the pair bases of every submatrix with the given left string,
+        indexed by the top string index.
     */
-    static string stepsToString(vector<int> steps) {
-        string ret = "";
-        ret.reserve(steps.size());
-        for (unsigned int i = 0; i < steps.size(); i++) {
-            ret += steps[i] + '1';
-        }
-        return ret;
+    inline const unsigned int* getPairBases(int strLeft) const {
+        return &pairBases[strLeft * stringCount];
     }
 
     /*
-        Returns the total memory offset for the matrix represented by the four
-        provided parameters (initial step vectors and initial strings).
+        Returns the precalculated final step codes (right column, bottom row)
+        of the submatrix described by a pair base and the left and top step
+        codes.
     */
-    inline int getOffset(string strLeft, string strTop, string stepLeft, string stepTop) {
-        int offset = 0;
-
-        for (int i = 0; i < this->dimension; i++) {
-            offset += charLeftOffset[this->dimension - i - 1][alphabetMap[strLeft[i]]];
-            offset += charTopOffset[this->dimension - i - 1][alphabetMap[strTop[i]]];
-            offset += stepLeftOffset[this->dimension - i - 1][stepLeft[i] - '0'];
-            offset += stepTopOffset[this->dimension - i - 1][stepTop[i] - '0'];
+    inline pair<int, int> getFinalSteps(unsigned int pairBase, int stepLeft,
+                                        int stepTop) const {
+        unsigned int swapped = pairBase & 1;
+        unsigned int first = swapped ? stepTop : stepLeft;
+        unsigned int second = swapped ? stepLeft : stepTop;
+        if (lazyStore != NULL) {
+            pair<int, int> steps = getLazyFinalSteps(pairBase >> 1, first, second);
+            return swapped ? make_pair(steps.second, steps.first) : steps;
         }
-
-        return offset;
+        const uint8_t* entry =
+            resultIndex + 2 * ((pairBase >> 1) + first * stepCount + second);
+        return make_pair(entry[swapped], entry[swapped ^ 1]);
     }
 
     /*
-        Precalculates some offsets for step and string indexing. Saves time
-        during any bottleneck involving submatrix retrieval / storage.
+        Returns the index of a string of dimension symbol codes. Only strings
+        made of alphabet characters followed by blanks can appear in a block.
+        Strings with more alphabet characters get lower indices, and within
+        the same number of characters the index is the base-|alphabet| value
+        of the characters, so a string without blanks is indexed by its plain
+        base-|alphabet| value.
     */
-    void calculateOffsets() {
-        // calculate the memory offsets for submatrix storage for each individual symbol
-        int temp_offset = 1;
-        for (int i = 0; i < this->dimension; i++) {
-            for (int j = 0; j < 3; j++) {
-                stepTopOffset[i].push_back(j * temp_offset);
-            }
-            temp_offset *= 3;
-        }
-        for (int i = 0; i < this->dimension; i++) {
-            for (int j = 0; j < 3; j++) {
-                stepLeftOffset[i].push_back(j * temp_offset);
-            }
-            temp_offset *= 3;
-        }
-        for (int i = 0; i < this->dimension; i++) {
-            for (unsigned int j = 0; j <= this->alphabet.size(); j++) {
-                charTopOffset[i].push_back(j * temp_offset);
-            }
-            temp_offset *= (this->alphabet.size() + 1);
-        }
-        for (int i = 0; i < this->dimension; i++) {
-            for (unsigned int j = 0; j <= this->alphabet.size(); j++) {
-                charLeftOffset[i].push_back(j * temp_offset);
-            }
-            temp_offset *= (this->alphabet.size() + 1);
-        }
-
-        if (initialSteps.size() == 0){
-            cout << "Missing initial steps." << endl;
-            return;
-        }
+    int getStringIndex(const uint8_t* codes) const;
 
-        // setting the offset index length
-        int stepOffsetMaxAddress = 0;
-        for (int i = 0; i < this->dimension; i++){
-            stepOffsetMaxAddress = (stepOffsetMaxAddress * 10) + 2;
-        }
-        stepOffsets[0].resize(++stepOffsetMaxAddress); // left steps
-        stepOffsets[1].resize(++stepOffsetMaxAddress); // top steps
+    // writes the symbol codes of the string with the given index; inverse of
+    // getStringIndex()
+    void getStringCodes(int index, uint8_t* codes) const;
 
-        /*// DEBUG step offset locations
-        cout << "Reserved (2x) " << stepOffsetMaxAddress << " step offset locations." << endl;*/
-
-        for (unsigned int i = 0; i < initialSteps.size(); i++){
-            int stepNumeric = 0;
-            int offsetLeft = 0;
-            int offsetTop = 0;
-            for (int j = 0; j < this->dimension; j++){
-                stepNumeric *= 10;
-                stepNumeric += initialSteps[i][j] - '0';
-                offsetLeft += stepLeftOffset[this->dimension - j - 1][initialSteps[i][j] - '0'];
-                offsetTop += stepTopOffset[this->dimension - j - 1][initialSteps[i][j] - '0'];
-            }
-            stepOffsets[0][stepNumeric] = offsetLeft;
-            stepOffsets[1][stepNumeric] = offsetTop;
-
-            /*// DEBUG
-            cout << i << ": " << initialSteps[i] << " " << stepNumeric << " -> " << offsetLeft << " " << offsetTop << endl;*/
-        }
-
-        /*// DEBUG address offset printing
-        for (int j = this->dimension - 1; j >= 0; j--) {
-            for (unsigned int i = 0; i < charLeftOffset[j].size(); i++)
-                cout << charLeftOffset[j][i] << " ";
-            cout << "   ";
-        }
-        cout << endl << endl;
-
-        for (int j = this->dimension - 1; j >= 0; j--) {
-            for (unsigned int i = 0; i < charTopOffset[j].size(); i++)
-                cout << charTopOffset[j][i] << " ";
-            cout << "   ";
-        }
-        cout << endl << endl;
-
-        for (int j = this->dimension - 1; j >= 0; j--) {
-            for (unsigned int i = 0; i < stepLeftOffset[j].size(); i++)
-                cout << stepLeftOffset[j][i] << " ";
-            cout << "   ";
-        }
-        cout << endl << endl;
+    /*
+        Returns the symbol code of a character: its index in the alphabet, or
+        the alphabet size for the blank character. Characters outside the
+        alphabet share the code of the first alphabet character.
+    */
+    inline int symbolCode(char c) const {
+        return symbolCodes[(unsigned char)c];
+    }
 
-        for (int j = this->dimension - 1; j >= 0; j--) {
-            for (unsigned int i = 0; i < stepTopOffset[j].size(); i++)
-                cout << stepTopOffset[j][i] << " ";
-            cout << "   ";
+    /*
+        Writes the step values encoded in the step code to steps, which has to
+        hold dimension values.
+    */
+    inline void decodeSteps(int code, int* steps) const {
+        for (int i = this->dimension - 1; i >= 0; i--) {
+            steps[i] = code % stepBase - stepOffset;
+            code /= stepBase;
         }
-        cout << endl << endl;
-        */
     }
 
     /*
-        Sums the step values encoded in stepsNumeric to get the
+        Sums the step values encoded in the step code to get the
         total difference over that step vector.
     */
-    int sumSteps(int stepsNumeric){
-        int sum = 0;
-        for (int i = 0; i < this->dimension; i++){
-            sum += stepsNumeric % 10 - 1;
-            stepsNumeric /= 10;
-        }
-        return sum;
+    inline int sumSteps(int steps) const {
+        return stepSums[steps];
     }
 
     /*
-        Transforms a vector of steps to a single integer. Used for
-        addressing using steps as indices.
+        Largest and smallest partial sum of the step values encoded in the
+        step code, i.e. the extremes of the cells the steps lead to relative
+        to the cell before the first step.
     */
-    static int stepsToInt(vector<int> steps){
-        int ret = 0;
-        for (unsigned int i = 0; i < steps.size(); i++){
-            ret = ret * 10 + steps[i] + 1;
-        }
-        return ret;
+    inline int maxPartialSteps(int steps) const {
+        return stepMaxima[steps];
+    }
+    inline int minPartialSteps(int steps) const {
+        return stepMinima[steps];
     }
 
     /*
-        Transforms the steps encoded as an integer to a vector of step values.
+        Returns the code of a first-row step vector of a block with count
+        cells of the second string: count steps of insertCost followed by
+        steps of 0 over the padding.
     */
-    vector<int> stepsToVector(int steps){
-        vector<int> rev;
-        for (int i = 0; i < this->dimension; i++){
-            rev.push_back(steps % 10 - 1);
-            steps /= 10;
-        }
-
-        vector<int> ret;
-        for (int i = rev.size() - 1; i >= 0; i--){
-            ret.push_back(rev[i]);
-        }
-        return ret;
+    inline int getRowBoundarySteps(int count) const {
+        return rowBoundarySteps[count];
     }
 
     /*
-        Adds spaces and signs to the step string and transforms the values to real
-        step values.
+        Returns the code of a first-column step vector of a block with count
+        cells of the first string: count steps of deleteCost followed by
+        steps of 0 over the padding.
     */
-    string stepsToPrettyString(string steps) {
-        string ret = "";
-        for (unsigned int i = 0; i < steps.size(); i++) {
-            if (steps[i] == '0') {
-                ret += "-1 ";
-            } else if (steps[i] == '2') {
-                ret += "+1 ";
-            } else {
-                ret += "0 ";
-            }
-        }
-        return ret;
+    inline int getColumnBoundarySteps(int count) const {
+        return columnBoundarySteps[count];
     }
 
     /*
-        Transforms the string of steps (possibly a result of stepsToString()) to a
-       vector of steps,
-        where each step value is expected to be in {-1, 0, 1}. I.e., the steps
-       string characters
-        are expected to be in {'0', '1', '2'}.
+        Transforms the steps encoded as an integer to a vector of step values.
     */
-    static vector<int> stepsToVector(string steps) {
-        vector<int> ret;
-        ret.reserve(steps.size());
-        for (unsigned int i = 0; i < steps.size(); i++) {
-            ret.push_back(steps[i] - '1');
-        }
+    vector<int> stepsToVector(int steps) const {
+        vector<int> ret(this->dimension, 0);
+        decodeSteps(steps, &ret[0]);
         return ret;
     }
 
-    pair<int, int>* resultIndex;
-    // mapping of step vectors to offsets; 0 - left, 1 - top
-    vector<int> stepOffsets[2];
 private:
     int dimension;
-    int replaceCost;
-    int deleteCost;
-    int insertCost;
-    // the actual maximum number of submatrices should be much lower
-    // in order to decrease the possibility of hash collisions
-    // when storing results
+    EditCosts costs;
+    // replacement cost of every pair of alphabet symbol codes
+    vector<int> replaceTable;
+    bool unitCosts;
     string alphabet;
-    map<char, int> alphabetMap;
+    uint8_t symbolCodes[256];
     char blankCharacter;
-    vector<string> initialSteps;
-    vector<string> initialStrings;
 
-    // memory offsets; used when storing/loading submatrices
-    vector<int> charLeftOffset[3];
-    vector<int> charTopOffset[3];
-    vector<int> stepLeftOffset[3];
-    vector<int> stepTopOffset[3];
+    // number of strings and step vectors, and whether transposed pairs share
+    // their entries
+    int stringCount;
+    int stepCount;
+    bool symmetric;
+    // radix of the step codes and the offset of a step within a digit
+    int stepBase;
+    int stepOffset;
+    // index of the first string with the given number of alphabet characters
+    vector<int> stringOffsets;
+    // step sum and extreme partial sums of every step code
+    vector<int> stepSums;
+    vector<int> stepMaxima;
+    vector<int> stepMinima;
+    // see getRowBoundarySteps() and getColumnBoundarySteps()
+    vector<int> rowBoundarySteps;
+    vector<int> columnBoundarySteps;
+    // entry base of every (left string, top string) pair; see getPairBase()
+    vector<unsigned int> pairBases;
 
-    // allocation time, matrix calculation time
-    double times[2];
+    // two bytes per entry; see getFinalSteps()
+    uint8_t* resultIndex;
+    // number of entries in resultIndex
+    size_t resultSize;
+    // read-only mapping of a cache file backing resultIndex, if loaded
+    void* mappedData;
+    size_t mappedSize;
+    // lazy-mode entry store and the hash shift addressing it
+    atomic<uint64_t>* lazyStore;
+    unsigned int lazyShift;
+    // packed paths of every entry, orientation and entry cell, see
+    // calculatePaths(), and the number of entry cells per orientation
+    vector<uint16_t> pathIndex;
+    int pathCells;
+
+    /*
+        State of the prefix-sharing enumeration of left strings and left steps
+        for one top string and top step vector; see calculateRows().
+    */
+    struct RowContext {
+        int topIndex;
+        int topSteps;
+        uint8_t topChars[SUBMATRIX_MAX_DIMENSION];
+        Scratch* scratch;
+    };
 
-    // temporary matrices
-    vector<vector<int> > lastSubH, lastSubV;
+    void calculateIndexing();
+    void calculatePairBases();
+    pair<int, int> getLazyFinalSteps(unsigned int pairIndex, int stepLeft,
+                                     int stepTop) const;
+    void calculateRows(RowContext& context, int row, int prefixChars,
+                       int prefixCode, bool blanks, int stepCode,
+                       int rightCode);
+    void calculateRange(atomic<unsigned int>* nextString);
+    void calculatePathRange(atomic<unsigned int>* nextString);
+    void setPathExit(int i, int j, PathExit& exit) const;
 };
 #endif
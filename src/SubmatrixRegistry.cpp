@@ -0,0 +1,121 @@
+#include "SubmatrixRegistry.hpp"
+
+// lexicographic ordering of table keys, used by the registry map
+bool SubmatrixRegistry::Key::operator<(const Key& other) const {
+  if (dimension != other.dimension) return dimension < other.dimension;
+  if (alphabet != other.alphabet) return alphabet < other.alphabet;
+  if (blankCharacter != other.blankCharacter)
+    return blankCharacter < other.blankCharacter;
+  if (paths != other.paths) return paths < other.paths;
+  return costs < other.costs;
+}
+
+// destructor; releases every table still held by the registry
+SubmatrixRegistry::~SubmatrixRegistry() {
+  for (auto& entry : tables_) {
+    delete entry.second;
+  }
+}
+
+// the single registry instance, created on first use
+SubmatrixRegistry& SubmatrixRegistry::instance() {
+  static SubmatrixRegistry registry;
+  return registry;
+}
+
+// returns the table for the given parameters, calculating it on first use
+const SubmatrixCalculator* SubmatrixRegistry::get(int dimension,
+                                                  string alphabet,
+                                                  char blankCharacter,
+                                                  int replaceCost,
+                                                  int deleteCost,
+                                                  int insertCost) {
+  return get(dimension, alphabet, blankCharacter,
+             EditCosts(replaceCost, deleteCost, insertCost));
+}
+
+// the same for any edit costs, including substitution matrices
+const SubmatrixCalculator* SubmatrixRegistry::get(int dimension,
+                                                  string alphabet,
+                                                  char blankCharacter,
+                                                  const EditCosts& costs) {
+  SubmatrixRegistry& registry = instance();
+
+  // the lock is held during calculation so concurrent requests for the same
+  // key wait for a single build instead of racing to build it twice
+  lock_guard<mutex> guard(registry.lock_);
+  Key key = {dimension, alphabet, blankCharacter, costs, registry.paths_};
+  map<Key, SubmatrixCalculator*>::iterator it = registry.tables_.find(key);
+  if (it != registry.tables_.end()) {
+    return it->second;
+  }
+
+  SubmatrixCalculator* table =
+      new SubmatrixCalculator(dimension, alphabet, blankCharacter, costs);
+
+  if (registry.lazy_ || !table->tableFits()) {
+    // too large to materialize, or requested: calculate entries on first use
+    table->calculateLazy();
+  } else if (registry.cacheDirectory_.empty()) {
+    table->calculate(registry.threads_);
+  } else {
+    string path = registry.cacheDirectory_ + "/" + table->cacheFileName();
+    bool loaded;
+    {
+      PhaseTimer timer(Metrics::TABLE_LOAD);
+      loaded = table->load(path);
+    }
+    if (!loaded) {
+      table->calculate(registry.threads_);
+      if (!table->save(path)) {
+        cout << "Could not write submatrix table to " << path << endl;
+      }
+    }
+  }
+  // paths are not part of the cache files, so they are always calculated
+  if (registry.paths_ && table->pathTableFits()) {
+    table->calculatePaths(registry.threads_);
+  }
+  registry.tables_[key] = table;
+
+  return table;
+}
+
+// releases all tables; pointers returned by get() become invalid
+void SubmatrixRegistry::clear() {
+  SubmatrixRegistry& registry = instance();
+  lock_guard<mutex> guard(registry.lock_);
+
+  for (auto& entry : registry.tables_) {
+    delete entry.second;
+  }
+  registry.tables_.clear();
+}
+
+// number of threads used to calculate new tables; 0 uses every core
+void SubmatrixRegistry::setThreads(int threads) {
+  SubmatrixRegistry& registry = instance();
+  lock_guard<mutex> guard(registry.lock_);
+  registry.threads_ = threads;
+}
+
+// directory of persistent table files; an empty string disables the cache
+void SubmatrixRegistry::setCacheDirectory(const string& directory) {
+  SubmatrixRegistry& registry = instance();
+  lock_guard<mutex> guard(registry.lock_);
+  registry.cacheDirectory_ = directory;
+}
+
+// whether new tables calculate their entries on first use
+void SubmatrixRegistry::setLazy(bool lazy) {
+  SubmatrixRegistry& registry = instance();
+  lock_guard<mutex> guard(registry.lock_);
+  registry.lazy_ = lazy;
+}
+
+// whether new tables also precalculate their traceback paths
+void SubmatrixRegistry::setPathTables(bool paths) {
+  SubmatrixRegistry& registry = instance();
+  lock_guard<mutex> guard(registry.lock_);
+  registry.paths_ = paths;
+}
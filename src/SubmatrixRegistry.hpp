@@ -0,0 +1,79 @@
+#ifndef SUBMATRIXREGISTRY_HPP
+#define SUBMATRIXREGISTRY_HPP
+
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "SubmatrixCalculator.hpp"
+
+using namespace std;
+
+/*
+Process-wide registry of precalculated submatrix tables. A table is built the
+first time it is requested for a given (dimension, alphabet, blank character,
+costs) combination; every later request gets the same read-only table, so a
+run over many sequence pairs pays for table generation only once per key.
+With a cache directory set, tables also persist across runs as memory-mapped
+files.
+*/
+class SubmatrixRegistry {
+ public:
+  // returns the table for the given parameters, calculating it on first use
+  static const SubmatrixCalculator* get(int dimension, string alphabet = "ATGC",
+                                        char blankCharacter = '-',
+                                        int replaceCost = 1,
+                                        int deleteCost = 1,
+                                        int insertCost = 1);
+  static const SubmatrixCalculator* get(int dimension, string alphabet,
+                                        char blankCharacter,
+                                        const EditCosts& costs);
+
+  // releases all tables; pointers returned by get() become invalid
+  static void clear();
+
+  // number of threads used to calculate new tables; 0 uses every core
+  static void setThreads(int threads);
+
+  // directory of persistent table files; tables found there are mapped
+  // instead of calculated, and newly calculated tables are stored there.
+  // An empty string disables the cache.
+  static void setCacheDirectory(const string& directory);
+
+  // whether new tables calculate their entries on first use instead of up
+  // front; tables too large to calculate up front are always lazy. Lazy
+  // tables bypass the cache directory.
+  static void setLazy(bool lazy);
+
+  // whether new tables also precalculate the traceback of every entry (see
+  // SubmatrixCalculator::calculatePaths()); tables with and without paths
+  // are separate entries, so tables already handed out never change. Lazy
+  // tables and tables whose paths would not fit trace every block instead
+  static void setPathTables(bool paths);
+
+ private:
+  struct Key {
+    int dimension;
+    string alphabet;
+    char blankCharacter;
+    EditCosts costs;
+    // whether the table was built with path tables requested
+    bool paths;
+
+    bool operator<(const Key& other) const;
+  };
+
+  SubmatrixRegistry() : threads_(0), lazy_(false), paths_(false) {}
+  ~SubmatrixRegistry();
+
+  static SubmatrixRegistry& instance();
+
+  map<Key, SubmatrixCalculator*> tables_;
+  int threads_;
+  bool lazy_;
+  bool paths_;
+  string cacheDirectory_;
+  mutex lock_;
+};
+
+#endif
@@ -0,0 +1,77 @@
+#include "WorkStealingPool.hpp"
+
+#include <algorithm>
+#include <thread>
+
+WorkStealingPool::WorkStealingPool(int threads) {
+  if (threads <= 0) threads = thread::hardware_concurrency();
+  threads_ = threads > 0 ? threads : 1;
+}
+
+void WorkStealingPool::run(const vector<int>& order,
+                           const function<void(int, int)>& job) {
+  int workers = min(threads_, (int)order.size());
+  if (workers <= 1) {
+    for (unsigned int k = 0; k < order.size(); k++) job(order[k], 0);
+    return;
+  }
+
+  vector<Queue> queues(workers);
+  for (unsigned int k = 0; k < order.size(); k++) {
+    queues[k % workers].jobs.push_back(order[k]);
+  }
+
+  vector<thread> pool;
+  for (int worker = 1; worker < workers; worker++) {
+    pool.push_back(thread(&WorkStealingPool::work, this, ref(queues), worker,
+                          cref(job)));
+  }
+  work(queues, 0, job);
+  for (unsigned int i = 0; i < pool.size(); i++) {
+    pool[i].join();
+  }
+}
+
+// runs jobs until every deque is empty; jobs never add jobs, so an empty
+// pool stays empty
+void WorkStealingPool::work(vector<Queue>& queues, int worker,
+                            const function<void(int, int)>& job) {
+  int index;
+  while (take(queues, worker, index)) {
+    job(index, worker);
+  }
+}
+
+// the next job of the worker: the front of its own deque, or else the back
+// of the fullest other one
+bool WorkStealingPool::take(vector<Queue>& queues, int worker, int& index) {
+  {
+    lock_guard<mutex> guard(queues[worker].lock);
+    if (!queues[worker].jobs.empty()) {
+      index = queues[worker].jobs.front();
+      queues[worker].jobs.pop_front();
+      return true;
+    }
+  }
+
+  while (true) {
+    int victim = -1;
+    unsigned int most = 0;
+    for (unsigned int other = 0; other < queues.size(); other++) {
+      lock_guard<mutex> guard(queues[other].lock);
+      if (queues[other].jobs.size() > most) {
+        most = queues[other].jobs.size();
+        victim = other;
+      }
+    }
+    if (victim < 0) return false;
+
+    // the victim may have drained in between; look again if so
+    lock_guard<mutex> guard(queues[victim].lock);
+    if (!queues[victim].jobs.empty()) {
+      index = queues[victim].jobs.back();
+      queues[victim].jobs.pop_back();
+      return true;
+    }
+  }
+}
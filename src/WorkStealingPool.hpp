@@ -0,0 +1,44 @@
+#ifndef WORKSTEALINGPOOL_HPP
+#define WORKSTEALINGPOOL_HPP
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+/*
+Runs a list of independent jobs on a fixed number of threads. Jobs are
+dealt round-robin to per-worker deques in the order given, so passing them
+most expensive first keeps every worker busy with large jobs before small
+ones. A worker takes jobs from the front of its own deque; once that is
+empty it steals from the back of the deque with the most jobs left.
+Each job is told which worker runs it, so callers can keep per-worker
+scratch state that is reused across that worker's jobs.
+*/
+class WorkStealingPool {
+ public:
+  // threads = 0 uses every available core
+  explicit WorkStealingPool(int threads = 0);
+
+  int size() const { return threads_; }
+
+  // calls job(index, worker) for every index of order and returns once all
+  // of them are done; worker is in [0, size())
+  void run(const vector<int>& order, const function<void(int, int)>& job);
+
+ private:
+  struct Queue {
+    deque<int> jobs;
+    mutex lock;
+  };
+
+  int threads_;
+
+  void work(vector<Queue>& queues, int worker,
+            const function<void(int, int)>& job);
+  bool take(vector<Queue>& queues, int worker, int& index);
+};
+
+#endif
@@ -1,48 +1,134 @@
-#include "Writer.hpp"
-
-using namespace std;
-
-// Constructor; take single argument filename which should be path to file.
-// Overwrites existing file or creates a new one.
-Writer::Writer(const char* filename) { out_.open(filename, ofstream::out); };
-
-// destructor; close output stream on destruction
-Writer::~Writer() { out_.close(); }
-
-// converts a single sequence to 's' line of MAF format
-const string toStr(Sequence* seq) {
-  ostringstream out;
-  string data = seq->getData();
-  out << "s " << seq->getIdentifier() << " 0 "
-      << count_if(data.begin(), data.end(), [](char c) { return c != '-'; })
-      << " + " << data.size() << " " << data;
-  return out.str();
-}
-
-// method for writing vector of results to output file; creates an alignemnt
-// block for every result in vector
-void Writer::writeResults(vector<Result*> results) {
-  for (Result* result : results) {
-    Writer::out_ << "a score=" << result->getScore() << endl;
-    Writer::out_ << toStr(result->getA()) << endl;
-    Writer::out_ << toStr(result->getB()) << endl
-                 << endl;
-  }
-};
-
-/* 'Unit' test
-int main()
-{
-    Sequence s1("test1", "ATG-TT");
-    Sequence s2("test2", "-TGAT-");
-
-    Result r(s1, s2, 522.3);
-    vector<Result*> results;
-    results.push_back(&r);
-    results.push_back(&r);
-    results.push_back(&r);
-
-    Writer w("test.out");
-    w.writeResults(results);
-}
-*/
+#include "Writer.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace std;
+
+// size of the output buffer, and so of most write() calls
+static const size_t BUFFER_SIZE = 1 << 20;
+
+// Constructor; take single argument filename which should be path to file.
+// Overwrites existing file or creates a new one.
+Writer::Writer(const char* filename)
+    : filename_(filename), buffer_(BUFFER_SIZE), used_(0) {
+  fd_ = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0) {
+    error_ = string("Could not open ") + filename + ": " + strerror(errno);
+  }
+};
+
+// destructor; flush the buffer and close the file on destruction
+Writer::~Writer() {
+  flush();
+  if (fd_ >= 0) close(fd_);
+}
+
+// writes size bytes straight to the file, retrying short writes; after a
+// failure nothing more is written
+void Writer::writeAll(const char* data, size_t size) {
+  if (fd_ < 0 || failed()) return;
+  while (size > 0) {
+    ssize_t written = write(fd_, data, size);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      error_ = string("Could not write ") + filename_ + ": " + strerror(errno);
+      return;
+    }
+    data += written;
+    size -= written;
+  }
+}
+
+void Writer::flush() {
+  PhaseTimer timer(Metrics::OUTPUT);
+  writeBuffer();
+}
+
+void Writer::writeBuffer() {
+  writeAll(buffer_.data(), used_);
+  used_ = 0;
+}
+
+// copies data into the buffer; data larger than the buffer bypasses it
+void Writer::append(const char* data, size_t size) {
+  if (used_ + size > buffer_.size()) {
+    writeBuffer();
+    if (size >= buffer_.size()) {
+      writeAll(data, size);
+      return;
+    }
+  }
+  memcpy(&buffer_[used_], data, size);
+  used_ += size;
+}
+
+void Writer::appendNumber(size_t value) {
+  char digits[24];
+  int length = snprintf(digits, sizeof(digits), "%zu", value);
+  append(digits, length);
+}
+
+// appends a single sequence as 's' line of MAF format: the aligned symbols
+// start at start of a source sequence of sourceSize symbols
+void Writer::appendSequence(Sequence* seq, size_t start, size_t symbols,
+                            size_t sourceSize) {
+  append("s ", 2);
+  const string& identifier = seq->getIdentifier();
+  append(identifier.data(), identifier.size());
+  append(" ", 1);
+  appendNumber(start);
+  append(" ", 1);
+  appendNumber(symbols);
+  append(" + ", 3);
+  appendNumber(sourceSize);
+  append(" ", 1);
+  if (seq->isPacked()) {
+    string data = seq->unpack();
+    append(data.data(), data.size());
+  } else {
+    append(seq->getData().data(), seq->getData().size());
+  }
+  append("\n", 1);
+}
+
+// creates an alignment block for the result
+void Writer::writeResult(Result* result) {
+  PhaseTimer timer(Metrics::OUTPUT);
+  // %g formats the score as the default stream output did
+  char score[32];
+  int length = snprintf(score, sizeof(score), "a score=%g\n",
+                        result->getScore());
+  append(score, length);
+  appendSequence(result->getA(), result->getStartA(), result->getSymbolsA(),
+                 result->getSourceSizeA());
+  appendSequence(result->getB(), result->getStartB(), result->getSymbolsB(),
+                 result->getSourceSizeB());
+  append("\n", 1);
+}
+
+// method for writing vector of results to output file; creates an alignemnt
+// block for every result in vector
+void Writer::writeResults(const vector<Result*>& results) {
+  for (Result* result : results) {
+    writeResult(result);
+  }
+};
+
+/* 'Unit' test
+int main()
+{
+    Result r(new Sequence("test1", "ATG-TT"), new Sequence("test2", "-TGAT-"),
+             522.3, 5, 4);
+    vector<Result*> results;
+    results.push_back(&r);
+    results.push_back(&r);
+    results.push_back(&r);
+
+    Writer w("test.out");
+    w.writeResults(results);
+}
+*/
@@ -1,29 +1,55 @@
-#ifndef WRITER_HPP
-#define WRITER_HPP
-
-#include <fstream>
-#include <sstream>
-#include <vector>
-#include <algorithm>
-#include <iostream>
-
-#include "Result.hpp"
-
-/*
-Writer for writing results to MAF file format.
-*/
-class Writer {
- private:
-  ofstream out_;
-
- public:
-  // Constructor; take single argument filename which should be path to file.
-  // Overwrites existing file or creates a new one.
-  Writer(const char* filename);
-  ~Writer();
-
-  // method for writing vector of results to output file
-  void writeResults(vector<Result*> results);
-};
-
-#endif
+#ifndef WRITER_HPP
+#define WRITER_HPP
+
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+#include "Metrics.hpp"
+#include "Result.hpp"
+
+/*
+Writer for writing results to MAF file format. Results are written one at a
+time as they become available; blocks are formatted into a reusable buffer
+that goes to the file in large write() calls, so memory does not grow with
+the number of results. Time spent writing counts as the output phase of
+Metrics.
+*/
+class Writer {
+ private:
+  int fd_;
+  string filename_;
+  vector<char> buffer_;
+  size_t used_;
+  // why the file could not be opened or written, empty if it could
+  string error_;
+
+  void writeAll(const char* data, size_t size);
+  void append(const char* data, size_t size);
+  void writeBuffer();
+  void appendNumber(size_t value);
+  void appendSequence(Sequence* seq, size_t start, size_t symbols,
+                      size_t sourceSize);
+
+ public:
+  // Constructor; take single argument filename which should be path to file.
+  // Overwrites existing file or creates a new one.
+  Writer(const char* filename);
+  // flushes the buffer and closes the file
+  ~Writer();
+
+  // writes the alignment block of a single result
+  void writeResult(Result* result);
+  // method for writing vector of results to output file
+  void writeResults(const vector<Result*>& results);
+  // writes the buffered blocks to the file
+  void flush();
+
+  // whether the file could not be opened or written; getError() says why.
+  // Nothing more is written after a failure.
+  bool failed() const { return !error_.empty(); }
+  const string& getError() const { return error_; }
+};
+
+#endif
@@ -1,78 +1,625 @@
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <utility>
+#include <unistd.h>
 
+#include "AffineEditDistance.hpp"
 #include "BasicEditDistance.hpp"
+#include "BatchEditDistance.hpp"
+#include "BitParallelEditDistance.hpp"
+#include "EditCosts.hpp"
+#include "LocalAlignment.hpp"
 #include "Solver.hpp"
+#include "SubmatrixRegistry.hpp"
+#include "Metrics.hpp"
 #include "Parser.hpp"
+#include "WorkStealingPool.hpp"
 #include "Writer.hpp"
 
 using namespace std;
 
 static const int MAX_SEQ_LENGTH = 1000000;
 
+static void usage(const char* program) {
+  cout << "Usage: " << program
+       << " [-t threads] [-j jobs] [-c cache_dir] [-s dimension] [-l]"
+          " [-k max_distance] [-w costs] [-g gap_costs] [-r scores] [-f ends]"
+          " [-T] [-P]"
+          " [-v] [-m metrics.json]"
+          " <algorithm>"
+          "  <input file.fa>"
+          " <output file.maf>"
+       << endl;
+}
+
+/*
+ Options of the pair calculations, see main().
+*/
+struct Options {
+  int dimension;
+  int threads;
+  bool bounded;
+  int maxDistance;
+  EditCosts costs;
+  // affine gap costs of algorithms g, G and l
+  int gapOpen;
+  int gapExtend;
+  // match reward and mismatch penalty of algorithm l
+  int match;
+  int mismatch;
+  // free end gaps of algorithms d, a and h, see Solver::setFreeEndGaps()
+  int endGaps;
+};
+
+/*
+ State a worker reuses across the pairs it calculates.
+*/
+struct PairScratch {
+  BasicEditDistance<> basic;
+  AffineEditDistance affine;
+  LocalAlignment local;
+
+  PairScratch() : basic("", ""), affine("", ""), local("", "") {}
+};
+
+// seconds elapsed since start, measured by the wall clock since pairs run
+// concurrently
+static double secondsSince(chrono::steady_clock::time_point start) {
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// the data of a sequence as a string, unpacked into buffer if packed
+static const string& sequenceData(const Sequence* sequence, string& buffer) {
+  if (!sequence->isPacked()) return sequence->getData();
+  buffer = sequence->unpack();
+  return buffer;
+}
+
+/*
+ A solver for the pair: straight over the packed data when both sequences
+ are packed, over the strings otherwise.
+*/
+static Solver* createSolver(const Sequence* a, const Sequence* b,
+                            const Options& options) {
+  Solver* solver;
+  if (a->isPacked() && b->isPacked()) {
+    solver = new Solver(a->getPacked(), b->getPacked(), options.dimension,
+                        options.costs);
+  } else {
+    // strings are read in place; only a packed one of the two is unpacked
+    string unpacked_a, unpacked_b;
+    solver = new Solver(sequenceData(a, unpacked_a),
+                        sequenceData(b, unpacked_b), "ATGC",
+                        options.dimension, options.costs);
+  }
+  solver->setThreads(options.threads);
+  solver->setFreeEndGaps(options.endGaps);
+  return solver;
+}
+
+/*
+ Parses the -f ends: a comma separated list of first-start, first-end,
+ second-start and second-end, where first and second stand for both ends of
+ that sequence.
+*/
+static bool parseEndGaps(const char* text, int& endGaps) {
+  endGaps = 0;
+  stringstream list(text);
+  string name;
+  while (getline(list, name, ',')) {
+    if (name == "first-start") {
+      endGaps |= Solver::FREE_FIRST_START;
+    } else if (name == "first-end") {
+      endGaps |= Solver::FREE_FIRST_END;
+    } else if (name == "second-start") {
+      endGaps |= Solver::FREE_SECOND_START;
+    } else if (name == "second-end") {
+      endGaps |= Solver::FREE_SECOND_END;
+    } else if (name == "first") {
+      endGaps |= Solver::FREE_FIRST_START | Solver::FREE_FIRST_END;
+    } else if (name == "second") {
+      endGaps |= Solver::FREE_SECOND_START | Solver::FREE_SECOND_END;
+    } else {
+      return false;
+    }
+  }
+  return endGaps != 0;
+}
+
+/*
+ Parses the -w costs: "replace,delete,insert", or
+ "transition,transversion,delete,insert" for DNA substitution weights.
+*/
+static bool parseCosts(const char* text, EditCosts& costs) {
+  int values[4];
+  char end;
+  int count = sscanf(text, "%d,%d,%d,%d%c", &values[0], &values[1],
+                     &values[2], &values[3], &end);
+  if (count == 3) {
+    costs = EditCosts(values[0], values[1], values[2]);
+  } else if (count == 4) {
+    costs = EditCosts::nucleotide("ATGC", values[0], values[1], values[2],
+                                  values[3]);
+  } else {
+    return false;
+  }
+  return costs.isValid();
+}
+
+// sets the costs of the Needleman-Wunsch mode; characters outside ATGC are
+// replaced at the plain replace cost
+static void applyCosts(BasicEditDistance<>& bed, const EditCosts& costs) {
+  const string alphabet = "ATGC";
+  for (int x = 0; x < 256; x++) {
+    for (int y = 0; y < 256; y++) {
+      int cost = costs.replaceCost;
+      if (x == y) {
+        cost = 0;
+      } else if (x == EDIST_BLANK) {
+        cost = costs.insertCost;
+      } else if (y == EDIST_BLANK) {
+        cost = costs.deleteCost;
+      }
+      bed.setCosts(x, y, cost);
+    }
+  }
+  for (unsigned int x = 0; x < alphabet.size(); x++) {
+    for (unsigned int y = 0; y < alphabet.size(); y++) {
+      bed.setCosts(alphabet[x], alphabet[y],
+                   costs.replace(x, y, alphabet.size()));
+    }
+  }
+}
+
+// sets the gap and replacement costs of the affine modes; the delete and
+// insert costs do not apply, gaps cost gapOpen + length * gapExtend
+static void applyAffineCosts(AffineEditDistance& aed, const Options& options) {
+  const string alphabet = "ATGC";
+  const EditCosts& costs = options.costs;
+  aed.setGapCosts(options.gapOpen, options.gapExtend);
+  for (int x = 0; x < 256; x++) {
+    for (int y = 0; y < 256; y++) {
+      aed.setCosts(x, y, x == y ? 0 : costs.replaceCost);
+    }
+  }
+  for (unsigned int x = 0; x < alphabet.size(); x++) {
+    for (unsigned int y = 0; y < alphabet.size(); y++) {
+      aed.setCosts(alphabet[x], alphabet[y],
+                   costs.replace(x, y, alphabet.size()));
+    }
+  }
+  aed.setThreads(options.threads);
+}
+
+// prints the metrics with -v and writes them as JSON to the -m file
+static void reportMetrics(bool verbose, const string& metricsFile) {
+  if (verbose) Metrics::print(cout);
+  if (metricsFile == "-") {
+    Metrics::writeJson(cout);
+  } else if (!metricsFile.empty()) {
+    ofstream out(metricsFile.c_str());
+    if (!out) {
+      cout << "Could not write metrics to " << metricsFile << endl;
+      return;
+    }
+    Metrics::writeJson(out);
+  }
+}
+
+/*
+ Calculates one pair with the given algorithm; timing receives the line
+ reporting how long it took.
+*/
+static Result* calculatePair(char algorithm, const Options& options,
+                             Sequence* a, Sequence* b, PairScratch& scratch,
+                             string& timing) {
+  ostringstream report;
+  chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+  string unpacked_a, unpacked_b;
+  Metrics::add(Metrics::PAIRS, 1);
+
+  if (algorithm == 'b') {
+    BasicEditDistance<>& bed = scratch.basic;
+    bed.setStrings(sequenceData(a, unpacked_a), sequenceData(b, unpacked_b));
+
+    int score;
+    {
+      PhaseTimer timer(Metrics::FILL);
+      score = options.bounded && options.maxDistance >= 0
+                  ? bed.calculate(options.maxDistance)
+                  : bed.getResult();
+    }
+    report << "Edit distance calculation (Needleman-Wunsch): "
+           << secondsSince(startTime);
+    timing = report.str();
+
+    return new Result(a, b, score);
+  } else if (algorithm == 'm') {
+    BitParallelEditDistance bped(sequenceData(a, unpacked_a),
+                                 sequenceData(b, unpacked_b));
+
+    int score;
+    {
+      PhaseTimer timer(Metrics::FILL);
+      score = bped.calculate();
+    }
+    report << "Edit distance calculation (Myers, "
+           << BitParallelEditDistance::getKernelName(
+                  BitParallelEditDistance::getKernel())
+           << "): " << secondsSince(startTime);
+    timing = report.str();
+
+    return new Result(a, b, score);
+  } else if (algorithm == 'g') {
+    AffineEditDistance& aed = scratch.affine;
+    aed.setStrings(sequenceData(a, unpacked_a), sequenceData(b, unpacked_b));
+    int score = aed.calculate();
+    report << "Edit distance calculation (Gotoh): "
+           << secondsSince(startTime);
+    timing = report.str();
+
+    return new Result(a, b, score);
+  } else if (algorithm == 'G') {
+    AffineEditDistance& aed = scratch.affine;
+    aed.setStrings(sequenceData(a, unpacked_a), sequenceData(b, unpacked_b));
+    pair<int, pair<string, string>> res = aed.calculate_with_path();
+    report << "Edit path calculation (Gotoh): " << secondsSince(startTime);
+    timing = report.str();
+
+    return new Result(new Sequence(a->getIdentifier(), move(res.second.first)),
+                      new Sequence(b->getIdentifier(), move(res.second.second)),
+                      res.first, a->size(), b->size());
+  } else if (algorithm == 'l') {
+    LocalAlignment& la = scratch.local;
+    la.setStrings(sequenceData(a, unpacked_a), sequenceData(b, unpacked_b));
+    pair<LocalAlignment::Hit, pair<string, string>> res =
+        la.calculate_with_path();
+    const LocalAlignment::Hit& hit = res.first;
+    report << "Local alignment (Smith-Waterman): " << secondsSince(startTime);
+    timing = report.str();
+
+    return new Result(new Sequence(a->getIdentifier(), move(res.second.first)),
+                      new Sequence(b->getIdentifier(), move(res.second.second)),
+                      hit.score, hit.firstStart, hit.firstEnd - hit.firstStart,
+                      a->size(), hit.secondStart,
+                      hit.secondEnd - hit.secondStart, b->size());
+  } else if (algorithm == 'd') {
+    Solver* solver = createSolver(a, b, options);
+
+    int score;
+    if (!options.bounded) {
+      score = solver->calculate();
+    } else if (options.maxDistance < 0) {
+      score = solver->calculate_banded();
+    } else {
+      score = solver->calculate(options.maxDistance);
+    }
+    delete solver;
+    report << "Edit distance calculation (Masek-Paterson): "
+           << secondsSince(startTime);
+    timing = report.str();
+
+    return new Result(a, b, score);
+  }
+
+  Solver* solver = createSolver(a, b, options);
+  pair<int, pair<string, string>> res =
+      algorithm == 'h' ? solver->calculate_with_path_linear()
+                       : solver->calculate_with_path();
+  delete solver;
+  report << "Edit path calculation (Masek-Paterson): "
+         << secondsSince(startTime);
+  timing = report.str();
+
+  return new Result(new Sequence(a->getIdentifier(), move(res.second.first)),
+                    new Sequence(b->getIdentifier(), move(res.second.second)),
+                    res.first, a->size(), b->size());
+}
+
 /* Main program
- Usage: <algorithm>  <input file.fa> <output file.maf>
+ Usage: [-t threads] [-j jobs] [-c cache_dir] [-s dimension] [-l]
+        [-k max_distance] [-w costs] [-g gap_costs] [-r scores] [-f ends]
+        [-T] [-P] [-v] [-m metrics.json] <algorithm> <input file.fa>
+        <output file.maf>
+ Options:
+   -t threads    number of threads used for submatrix table generation and
+                 for filling the edit matrix of each pair (default: all
+                 available cores, shared out between the jobs of -j)
+   -j jobs       number of sequence pairs calculated at the same time; 0 uses
+                 every core (default: 1). Pairs are started largest first and
+                 the output keeps the order of a serial run.
+   -c cache_dir  directory where submatrix tables are stored between runs
+   -s dimension  submatrix dimension (default: chosen from the sequence length)
+   -l            calculate submatrices on first use instead of up front
+   -k max_distance  modes b and d only check whether each distance is at
+                 most max_distance; larger distances are reported as
+                 max_distance + 1. A negative value makes mode d compute
+                 exact distances by band doubling, which is fast for similar
+                 sequences. Other modes reject -k.
+   -w costs      edit costs as replace,delete,insert, or as
+                 transition,transversion,delete,insert to weight DNA
+                 substitutions (A <-> G and C <-> T are transitions); small
+                 whole numbers, 1,1,1 by default. Not supported by
+                 algorithms m and p; algorithms g and G only use the
+                 replacement costs, and algorithm l scores with -r instead.
+   -g gap_costs  affine gap costs of algorithms g, G and l as open,extend: a
+                 gap of k characters costs open + k * extend (default: 3,1)
+   -r scores     match reward and mismatch penalty of the local alignment
+                 algorithm l as match,mismatch (default: 2,3)
+   -f ends       end gaps of algorithms d, a and h that cost nothing, as a
+                 comma separated list of first-start, first-end,
+                 second-start and second-end; first and second free both
+                 ends of that sequence, so -f second finds where the first
+                 sequence fits best inside the second one.
+                 With -k algorithm d calculates the whole edit matrix.
+   -T            precalculate the traceback of every submatrix with the
+                 table, so the traceback of algorithm a is a chain of
+                 lookups; takes about ten times the memory of the table,
+                 and only applies to tables calculated up front (not -l)
+   -P            keep sequences packed in 2 bits per base while they wait
+                 to be calculated; the Masek-Paterson modes read their blocks
+                 straight from the packed data
+   -v            print the time of every pair and, at the end, the wall and
+                 CPU time of every phase with the work counters (see Metrics)
+   -m file       write the phase times and counters as JSON; - writes them to
+                 standard output
+ Without -v only warnings and errors are printed.
+ Algorithm p reads the input as a list of pairs instead of aligning every
+ sequence with every other one: records 1 and 2 form the first pair, 3 and 4
+ the second, and so on. All pairs are calculated together, one per SIMD lane.
+ Algorithm l writes the best local alignment of every pair; the MAF lines give
+ where the aligned part starts in each sequence and how long it is.
 */
 int main(int argc, char** argv) {
-  if (argc != 4) {
-    cout << "Usage: " << argv[0]
-         << " <algorithm>  <input file.fa> <output file.maf>" << endl;
+  Options options;
+  options.dimension = 0;
+  options.threads = 0;
+  options.bounded = false;
+  options.maxDistance = 0;
+  options.gapOpen = 3;
+  options.gapExtend = 1;
+  options.match = 2;
+  options.mismatch = 3;
+  options.endGaps = 0;
+  int jobCount = 1;
+  bool threadsGiven = false;
+  bool pack = false;
+  bool verbose = false;
+  string metricsFile;
+  int option;
+  while ((option = getopt(argc, argv, "t:j:c:s:lk:w:g:r:f:TPvm:")) != -1) {
+    if (option == 't') {
+      options.threads = atoi(optarg);
+      threadsGiven = true;
+      SubmatrixRegistry::setThreads(options.threads);
+    } else if (option == 'j') {
+      jobCount = atoi(optarg);
+    } else if (option == 'c') {
+      SubmatrixRegistry::setCacheDirectory(optarg);
+    } else if (option == 's') {
+      options.dimension = atoi(optarg);
+    } else if (option == 'l') {
+      SubmatrixRegistry::setLazy(true);
+    } else if (option == 'k') {
+      options.bounded = true;
+      options.maxDistance = atoi(optarg);
+    } else if (option == 'w') {
+      if (!parseCosts(optarg, options.costs)) {
+        cout << "Invalid costs " << optarg << endl;
+        return 1;
+      }
+    } else if (option == 'g') {
+      char end;
+      if (sscanf(optarg, "%d,%d%c", &options.gapOpen, &options.gapExtend,
+                 &end) != 2 ||
+          options.gapOpen < 0 || options.gapExtend < 0) {
+        cout << "Invalid gap costs " << optarg << endl;
+        return 1;
+      }
+    } else if (option == 'r') {
+      char end;
+      if (sscanf(optarg, "%d,%d%c", &options.match, &options.mismatch,
+                 &end) != 2 ||
+          options.match <= 0 || options.mismatch < 0) {
+        cout << "Invalid scores " << optarg << endl;
+        return 1;
+      }
+    } else if (option == 'f') {
+      if (!parseEndGaps(optarg, options.endGaps)) {
+        cout << "Invalid end gaps " << optarg << endl;
+        return 1;
+      }
+    } else if (option == 'T') {
+      SubmatrixRegistry::setPathTables(true);
+    } else if (option == 'P') {
+      pack = true;
+    } else if (option == 'v') {
+      verbose = true;
+    } else if (option == 'm') {
+      metricsFile = optarg;
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (argc - optind != 3) {
+    usage(argv[0]);
     return 1;
   }
 
-  char algorithm = argv[1][0];
-  char* in = argv[2];
-  char* out = argv[3];
+  char algorithm = argv[optind][0];
+  char* in = argv[optind + 1];
+  char* out = argv[optind + 2];
+
+  if ((algorithm == 'm' || algorithm == 'p') && !options.costs.isUnit()) {
+    cout << "Algorithm " << algorithm << " only supports unit costs" << endl;
+    return 1;
+  }
+  if (options.bounded && algorithm != 'b' && algorithm != 'd') {
+    cout << "Algorithm " << algorithm << " does not support -k" << endl;
+    return 1;
+  }
+  if (options.endGaps != 0 && algorithm != 'd' && algorithm != 'a' &&
+      algorithm != 'h') {
+    cout << "Algorithm " << algorithm << " does not support free end gaps"
+         << endl;
+    return 1;
+  }
+
+  // before any thread starts, so the counters follow every thread
+  if (verbose || !metricsFile.empty()) Metrics::startHardwareCounters();
 
   Parser p(in);
-  vector<Sequence*> sequences = p.readSequences();
+  if (p.failed()) {
+    cerr << p.getError() << endl;
+    return 1;
+  }
+  // opened before any work, so an unwritable output fails right away
+  Writer w(out);
+  if (w.failed()) {
+    cerr << w.getError() << endl;
+    return 1;
+  }
+  vector<Sequence*> sequences;
+  {
+    PhaseTimer timer(Metrics::INPUT);
+    sequences = p.readSequences();
+    if (pack) {
+      for (unsigned int i = 0; i < sequences.size(); i++) sequences[i]->pack();
+    }
+  }
 
-  vector<Result*> results;
-  for (unsigned int i = 0; i < sequences.size() - 1; i++) {
-    if (sequences[i]->getData().size() > MAX_SEQ_LENGTH) {
+  if (algorithm == 'p') {
+    BatchEditDistance batch;
+    vector<unsigned int> firsts;
+    for (unsigned int i = 0; i + 1 < sequences.size(); i += 2) {
+      if (sequences[i]->size() > MAX_SEQ_LENGTH ||
+          sequences[i + 1]->size() > MAX_SEQ_LENGTH) {
+        cout << "Pair " << i / 2 << " too long; skipping" << endl;
+        continue;
+      }
+      batch.add(sequences[i]->unpack(), sequences[i + 1]->unpack());
+      firsts.push_back(i);
+    }
+    if (sequences.size() % 2) {
+      cout << "Sequence " << sequences.size() - 1 << " has no pair; skipping"
+           << endl;
+    }
+
+    chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+    {
+      PhaseTimer timer(Metrics::FILL);
+      batch.calculate();
+    }
+    Metrics::add(Metrics::PAIRS, batch.size());
+    if (verbose) {
+      cout << "Edit distance calculation (batch of " << batch.size()
+           << " pairs, Myers, "
+           << BitParallelEditDistance::getKernelName(
+                  BitParallelEditDistance::getKernel())
+           << "): " << secondsSince(startTime) << endl;
+    }
+
+    for (unsigned int k = 0; k < firsts.size(); k++) {
+      Result result(sequences[firsts[k]], sequences[firsts[k] + 1],
+                    batch.getResults()[k]);
+      w.writeResult(&result);
+    }
+    w.flush();
+    if (w.failed()) {
+      cerr << w.getError() << endl;
+      return 1;
+    }
+    reportMetrics(verbose, metricsFile);
+    return 0;
+  }
+
+  // jobs in (i, j) order, which is also the order of the results
+  vector<pair<int, int>> jobs;
+  for (unsigned int i = 0; i + 1 < sequences.size(); i++) {
+    if (sequences[i]->size() > MAX_SEQ_LENGTH) {
       cout << "Sequence " << i << " too long; skipping" << endl;
       continue;
     }
     for (unsigned int j = i + 1; j < sequences.size(); j++) {
-      if (sequences[j]->getData().size() > MAX_SEQ_LENGTH) continue;
-
-      if (algorithm == 'b') {
-        BasicEditDistance bed(sequences[i]->getData(), sequences[j]->getData());
-
-        int startTime = clock();
-        int score = bed.getResult();
-        cout << "Edit distance calculation (Needleman-Wunsch): "
-             << (clock() - startTime) / double(CLOCKS_PER_SEC) << endl;
-
-        Result* result = new Result(sequences[i], sequences[j], score);
-        results.push_back(result);
-      } else if (algorithm == 'd') {
-        Solver solver(sequences[i]->getData(), sequences[j]->getData());
-
-        int startTime = clock();
-        int score = solver.calculate();
-        cout << "Edit distance calculation (Masek-Paterson): "
-             << (clock() - startTime) / double(CLOCKS_PER_SEC) << endl;
-
-        Result* result = new Result(sequences[i], sequences[j], score);
-        results.push_back(result);
-      } else {
-        Solver solver(sequences[i]->getData(), sequences[j]->getData());
-
-        int startTime = clock();
-        pair<int, pair<string, string>> res = solver.calculate_with_path();
-        cout << "Edit path calculation (Masek-Paterson): "
-             << (clock() - startTime) / double(CLOCKS_PER_SEC) << endl;
-
-        Result* result = new Result(
-            new Sequence(sequences[i]->getIdentifier(), res.second.first),
-            new Sequence(sequences[j]->getIdentifier(), res.second.second),
-            res.first);
-
-        results.push_back(result);
-      }
+      if (sequences[j]->size() > MAX_SEQ_LENGTH) continue;
+      jobs.push_back(make_pair(i, j));
     }
   }
 
-  Writer w(out);
-  w.writeResults(results);
+  WorkStealingPool pool(jobCount);
+  // without -t the jobs share the cores instead of each starting a thread
+  // per core
+  if (!threadsGiven && pool.size() > 1) {
+    options.threads =
+        max(1, (int)thread::hardware_concurrency() / pool.size());
+  }
+  vector<int> order(jobs.size());
+  for (unsigned int k = 0; k < jobs.size(); k++) order[k] = k;
+  // several workers start longest first, by the size of the edit matrix; a
+  // single one keeps the output order so no result waits to be written
+  if (pool.size() > 1) {
+    vector<double> sizes(jobs.size());
+    for (unsigned int k = 0; k < jobs.size(); k++) {
+      sizes[k] = double(sequences[jobs[k].first]->size()) *
+                 sequences[jobs[k].second]->size();
+    }
+    stable_sort(order.begin(), order.end(),
+                [&sizes](int a, int b) { return sizes[a] > sizes[b]; });
+  }
+
+  // results are written in job order as soon as every earlier one is done,
+  // and freed right after
+  vector<PairScratch> scratch(pool.size());
+  if (!options.costs.isUnit()) {
+    for (unsigned int i = 0; i < scratch.size(); i++) {
+      applyCosts(scratch[i].basic, options.costs);
+    }
+  }
+  if (algorithm == 'g' || algorithm == 'G') {
+    for (unsigned int i = 0; i < scratch.size(); i++) {
+      applyAffineCosts(scratch[i].affine, options);
+    }
+  }
+  if (algorithm == 'l') {
+    for (unsigned int i = 0; i < scratch.size(); i++) {
+      scratch[i].local.setScores(options.match, options.mismatch);
+      scratch[i].local.setGapCosts(options.gapOpen, options.gapExtend);
+      scratch[i].local.setThreads(options.threads);
+    }
+  }
+  vector<Result*> results(jobs.size(), NULL);
+  vector<string> timings(jobs.size());
+  unsigned int written = 0;
+  mutex outputLock;
+  pool.run(order, [&](int k, int worker) {
+    string timing;
+    Result* result =
+        calculatePair(algorithm, options, sequences[jobs[k].first],
+                      sequences[jobs[k].second], scratch[worker], timing);
+
+    lock_guard<mutex> lock(outputLock);
+    results[k] = result;
+    timings[k] = timing;
+    for (; written < results.size() && results[written] != NULL; written++) {
+      if (verbose) cout << timings[written] << endl;
+      w.writeResult(results[written]);
+      delete results[written];
+      string().swap(timings[written]);
+    }
+  });
+  w.flush();
+  if (w.failed()) {
+    cerr << w.getError() << endl;
+    return 1;
+  }
+  reportMetrics(verbose, metricsFile);
 }